@@ -0,0 +1,342 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "async_reader.hpp"
+#include "tools/thread_pool.hpp"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define PDFP_IO_URING
+#endif
+#endif
+
+#ifdef PDFP_IO_URING
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+namespace {
+
+    using pdf::async_reader;
+
+    /*
+        pread the whole request, retrying on short reads.
+    */
+    auto read_fully(int fd, const async_reader::request& r) noexcept -> long {
+        std::size_t done = 0;
+        while (done < r.length) {
+            auto n = pread(fd, r.buffer + done, r.length - done, static_cast<off_t>(r.offset + done));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+                return -1;
+            if (n == 0)
+                break;
+            done += n;
+        }
+        return static_cast<long>(done);
+    }
+
+    class pool_reader : public async_reader {
+    public:
+        pool_reader(int fd) : fd(fd), pool(4) {}
+
+        ~pool_reader() {
+            std::unique_lock<std::mutex> lock(mutex);
+            idle.wait(lock, [this] { return outstanding == 0; });
+        }
+
+        void submit(std::vector<request> requests) override {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                outstanding += requests.size();
+            }
+            for (auto& r : requests)
+                pool.submit([this, r] {
+                    r.done(read_fully(fd, r));
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (--outstanding == 0)
+                        idle.notify_all();
+                });
+        }
+
+    private:
+        int fd;
+        pdf::tools::thread_pool pool;
+        std::mutex mutex;
+        std::condition_variable idle;
+        std::size_t outstanding = 0;
+    };
+
+#ifdef PDFP_IO_URING
+
+    auto io_uring_setup(unsigned entries, io_uring_params* params) noexcept -> int {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    auto io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) noexcept -> int {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    auto io_uring_register(int fd, unsigned opcode, void* arg, unsigned count) noexcept -> int {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+    }
+
+    /*
+        A submission queue shared by all threads calling submit, and a thread which
+        reaps completions. Requests which are submitted but not yet completed are
+        limited to the size of the completion queue, so it can't overflow. The reaper
+        sleeps on an eventfd, which the kernel signals for every completion, and the
+        destructor signals to stop it.
+    */
+    class uring_reader : public async_reader {
+    public:
+        static const unsigned depth = 64;
+        // times to retry a submission the kernel has no resources for at the moment
+        static const int max_retries = 100;
+
+        // throws std::runtime_error if io_uring isn't available
+        uring_reader(int fd) : fd(fd) {
+            io_uring_params params = {};
+            ring = io_uring_setup(depth, &params);
+            if (ring < 0)
+                throw std::runtime_error("io_uring_setup failed");
+
+            sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            if (params.features & IORING_FEAT_SINGLE_MMAP)
+                sq_size = cq_size = std::max(sq_size, cq_size);
+            sq_ring = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+            cq_ring = params.features & IORING_FEAT_SINGLE_MMAP ? sq_ring
+                : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+            sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+            sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                                                   MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES));
+            if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqes == MAP_FAILED) {
+                unmap();
+                close(ring);
+                throw std::runtime_error("io_uring mmap failed");
+            }
+            event = eventfd(0, EFD_CLOEXEC);
+            if (event < 0 || io_uring_register(ring, IORING_REGISTER_EVENTFD, &event, 1) < 0) {
+                if (event >= 0)
+                    close(event);
+                unmap();
+                close(ring);
+                throw std::runtime_error("io_uring eventfd failed");
+            }
+
+            auto sq = static_cast<char*>(sq_ring);
+            sq_tail = reinterpret_cast<std::atomic<unsigned>*>(sq + params.sq_off.tail);
+            sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            auto cq = static_cast<char*>(cq_ring);
+            cq_head = reinterpret_cast<std::atomic<unsigned>*>(cq + params.cq_off.head);
+            cq_tail = reinterpret_cast<std::atomic<unsigned>*>(cq + params.cq_off.tail);
+            cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+            capacity = std::min(params.sq_entries, params.cq_entries);
+
+            reaper = std::thread([this] { reap(); });
+        }
+
+        ~uring_reader() {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                space.wait(lock, [this] { return outstanding == 0; });
+                stopping = true;
+            }
+            // unlike a request, this can't be refused
+            eventfd_write(event, 1);
+            reaper.join();
+            unmap();
+            close(ring);
+            close(event);
+        }
+
+        void submit(std::vector<request> requests) override {
+            std::vector<pending_read*> failed;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                unsigned queued = 0;
+                for (auto& r : requests) {
+                    if (outstanding == capacity) {
+                        push(queued, failed);
+                        queued = 0;
+                        space.wait(lock, [this] { return outstanding < capacity; });
+                    }
+                    // the request, with its iovec, lives until its completion is reaped
+                    auto pending = new pending_read{ std::move(r), iovec() };
+                    pending->iov.iov_base = pending->r.buffer;
+                    pending->iov.iov_len = pending->r.length;
+                    auto& sqe = next_sqe();
+                    sqe.opcode = IORING_OP_READV;
+                    sqe.fd = fd;
+                    sqe.off = pending->r.offset;
+                    sqe.addr = reinterpret_cast<std::uint64_t>(&pending->iov);
+                    sqe.len = 1;
+                    sqe.user_data = reinterpret_cast<std::uint64_t>(pending);
+                    ++outstanding;
+                    ++queued;
+                }
+                push(queued, failed);
+            }
+            // without the lock, so done can submit more requests
+            for (auto pending : failed) {
+                pending->r.done(-1);
+                delete pending;
+            }
+        }
+
+    private:
+        struct pending_read {
+            request r;
+            iovec iov;
+        };
+
+        int fd;
+        int ring;
+        int event; // signalled by completions, and to stop the reaper
+        void* sq_ring = MAP_FAILED;
+        void* cq_ring = MAP_FAILED;
+        io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+        std::size_t sq_size, cq_size, sqes_size;
+        std::atomic<unsigned>* sq_tail;
+        unsigned sq_mask;
+        unsigned* sq_array;
+        std::atomic<unsigned>* cq_head;
+        std::atomic<unsigned>* cq_tail;
+        unsigned cq_mask;
+        io_uring_cqe* cqes;
+        unsigned capacity;
+
+        std::mutex mutex;
+        std::condition_variable space;
+        unsigned outstanding = 0;
+        unsigned local_tail = 0;
+        bool stopping = false;
+        std::thread reaper;
+
+        // called with the mutex held
+        auto next_sqe() -> io_uring_sqe& {
+            auto index = local_tail++ & sq_mask;
+            sq_array[index] = index;
+            auto& sqe = sqes[index];
+            sqe = io_uring_sqe();
+            return sqe;
+        }
+
+        /*
+            Publish and submit the last count entries, called with the mutex held. If the
+            kernel won't take them, they are withdrawn from the ring, so a later submit
+            doesn't pass them on, and their reads are added to failed for the caller to
+            complete once it has released the mutex.
+        */
+        void push(unsigned count, std::vector<pending_read*>& failed) {
+            if (count == 0)
+                return;
+            sq_tail->store(local_tail, std::memory_order_release);
+            for (int retries = 0; count > 0;) {
+                int n = io_uring_enter(ring, count, 0, 0);
+                if (n > 0) {
+                    count -= n;
+                    continue;
+                }
+                if (n < 0 && (errno == EINTR || ((errno == EAGAIN || errno == EBUSY) && ++retries < max_retries))) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                withdraw(count, failed);
+                count = 0;
+            }
+        }
+
+        // take back the last count entries, which the kernel hasn't consumed
+        void withdraw(unsigned count, std::vector<pending_read*>& failed) {
+            local_tail -= count;
+            sq_tail->store(local_tail, std::memory_order_release);
+            for (unsigned i = local_tail; i != local_tail + count; ++i) {
+                failed.push_back(reinterpret_cast<pending_read*>(sqes[i & sq_mask].user_data));
+                --outstanding;
+            }
+            space.notify_all();
+        }
+
+        void reap() {
+            for (;;) {
+                auto head = cq_head->load(std::memory_order_relaxed);
+                if (head == cq_tail->load(std::memory_order_acquire)) {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (stopping && outstanding == 0)
+                            return;
+                    }
+                    // completions since the check above have already signalled it
+                    eventfd_t count;
+                    if (eventfd_read(event, &count) < 0 && errno != EINTR)
+                        return;
+                    continue;
+                }
+                auto cqe = cqes[head & cq_mask];
+                cq_head->store(head + 1, std::memory_order_release);
+                auto pending = reinterpret_cast<pending_read*>(cqe.user_data);
+                long result = cqe.res;
+                // a short read past the end of the file is fine, otherwise finish it with pread
+                if (result >= 0 && static_cast<std::size_t>(result) < pending->r.length) {
+                    request rest = pending->r;
+                    rest.offset += result;
+                    rest.buffer += result;
+                    rest.length -= result;
+                    auto more = read_fully(fd, rest);
+                    result = more < 0 ? -1 : result + more;
+                }
+                pending->r.done(result < 0 ? -1 : result);
+                delete pending;
+                std::lock_guard<std::mutex> lock(mutex);
+                --outstanding;
+                space.notify_all();
+            }
+        }
+
+        void unmap() noexcept {
+            if (sqes != MAP_FAILED)
+                munmap(sqes, sqes_size);
+            if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+                munmap(cq_ring, cq_size);
+            if (sq_ring != MAP_FAILED)
+                munmap(sq_ring, sq_size);
+        }
+    };
+
+#endif
+
+}
+
+namespace pdf {
+
+    auto make_async_reader(int fd, bool use_io_uring) -> std::unique_ptr<async_reader> {
+#ifdef PDFP_IO_URING
+        if (use_io_uring) {
+            try {
+                return std::make_unique<uring_reader>(fd);
+            } catch (std::runtime_error&) {
+                // not supported by this kernel, or not permitted (e.g. by seccomp)
+            }
+        }
+#else
+        (void)use_io_uring;
+#endif
+        return std::make_unique<pool_reader>(fd);
+    }
+
+}
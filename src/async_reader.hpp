@@ -0,0 +1,42 @@
+#ifndef ASYNC_READER_HPP
+#define ASYNC_READER_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace pdf {
+
+    /*
+        Reads parts of a file in the background. Each request is a read of length
+        bytes at offset into buffer. done is called exactly once for every request,
+        with the number of bytes read or -1 on failure. That is on some other thread,
+        except for requests which couldn't be started at all, which fail on the thread
+        calling submit before it returns, though not while it holds any locks.
+        The destructor waits for all outstanding requests to complete.
+    */
+    class async_reader {
+    public:
+        struct request {
+            std::uint64_t offset;
+            std::size_t length;
+            char* buffer;
+            std::function<void(long)> done;
+        };
+
+        virtual ~async_reader() {}
+
+        // requests are issued in the order given, so callers should sort them by offset
+        virtual void submit(std::vector<request> requests) = 0;
+    };
+
+    /*
+        Uses io_uring where the kernel supports it (and allows it), and otherwise
+        a few threads calling pread. fd must stay open while the reader exists.
+    */
+    auto make_async_reader(int fd, bool use_io_uring = true) -> std::unique_ptr<async_reader>;
+
+}
+
+#endif
@@ -0,0 +1,243 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "byte_source.hpp"
+#include "pdfp.hpp"
+
+namespace {
+
+    using pdf::tools::slice;
+
+    auto clip(slice input, std::uint64_t offset, std::size_t length) noexcept -> slice {
+        if (offset >= input.length())
+            return slice(input.end(), input.end());
+        return input.skip(static_cast<std::size_t>(offset)).left(length);
+    }
+
+}
+
+namespace pdf {
+
+    auto coalesce(std::vector<byte_extent> extents, std::uint64_t max_gap) -> std::vector<byte_extent> {
+        std::sort(extents.begin(), extents.end(),
+                  [](const byte_extent& a, const byte_extent& b) { return a.offset < b.offset; });
+        std::vector<byte_extent> merged;
+        for (const auto& extent : extents) {
+            if (!merged.empty() && extent.offset <= merged.back().offset + merged.back().length + max_gap) {
+                auto end = std::max(merged.back().offset + merged.back().length, extent.offset + extent.length);
+                merged.back().length = static_cast<std::size_t>(end - merged.back().offset);
+            } else if (extent.length != 0) {
+                merged.push_back(extent);
+            }
+        }
+        return merged;
+    }
+
+    auto memory_source::read(std::uint64_t offset, std::size_t length) const -> byte_range {
+        return byte_range(clip(input, offset, length));
+    }
+
+    auto mapped_source::read(std::uint64_t offset, std::size_t length) const -> byte_range {
+        return byte_range(clip(input, offset, length));
+    }
+
+    file_source::file_source(const std::string& filename, std::size_t page_size, std::size_t cache_pages,
+                             bool use_io_uring)
+        : page_size(std::max<std::size_t>(page_size, 1)), cache_pages(std::max<std::size_t>(cache_pages, 1)),
+          use_io_uring(use_io_uring) {
+        fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw pdf_error("file_source: can't open file");
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw pdf_error("file_source: can't stat file");
+        }
+        length = static_cast<std::uint64_t>(st.st_size);
+    }
+
+    file_source::~file_source() {
+        // wait for prefetches, which use fd and the cache
+        reader.reset();
+        close(fd);
+    }
+
+    auto file_source::bytes_read() const -> std::uint64_t {
+        std::lock_guard<std::mutex> lock(mutex);
+        return total_read;
+    }
+
+    /*
+        A range within a single page refers to the cached page, which its storage
+        keeps alive even after the page is evicted. Ranges spanning several pages
+        are copied.
+    */
+    auto file_source::read(std::uint64_t offset, std::size_t length) const -> byte_range {
+        if (offset >= this->length || length == 0)
+            return byte_range(slice(""));
+        length = static_cast<std::size_t>(std::min<std::uint64_t>(length, this->length - offset));
+        auto first = offset / page_size, last = (offset + length - 1) / page_size;
+        if (first == last) {
+            auto p = get_page(first);
+            auto begin = p->data() + (offset - first * page_size);
+            return byte_range(slice(begin, begin + length), p);
+        }
+
+        auto copy = std::make_shared<std::vector<char>>(length);
+        for (auto n = first; n <= last; ++n) {
+            auto p = get_page(n);
+            auto page_begin = n * page_size;
+            auto from = std::max(offset, page_begin), to = std::min(offset + length, page_begin + p->size());
+            std::memcpy(copy->data() + (from - offset), p->data() + (from - page_begin), to - from);
+        }
+        return byte_range(slice(copy->data(), copy->data() + copy->size()), copy);
+    }
+
+    auto file_source::get_page(std::uint64_t n) const -> page {
+        std::shared_future<page> prefetched;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto p = pages.find(n);
+            if (p != pages.end()) {
+                lru.splice(lru.begin(), lru, p->second.second);
+                return p->second.first;
+            }
+            auto f = in_flight.find(n);
+            if (f != in_flight.end())
+                prefetched = f->second;
+        }
+        if (prefetched.valid()) {
+            auto p = prefetched.get();
+            // a failed prefetch is retried below
+            if (p)
+                return p;
+        }
+
+        // read without holding the lock, so other threads can use the cache meanwhile
+        auto begin = n * page_size;
+        auto data = std::make_shared<std::vector<char>>(std::min<std::uint64_t>(page_size, length - begin));
+        std::size_t done = 0;
+        while (done < data->size()) {
+            auto r = pread(fd, data->data() + done, data->size() - done, static_cast<off_t>(begin + done));
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r <= 0)
+                throw pdf_error("file_source: read failed");
+            done += r;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        total_read += data->size();
+        return add_page(n, data);
+    }
+
+    // called with the mutex held
+    auto file_source::add_page(std::uint64_t n, page data) const -> page {
+        auto p = pages.find(n);
+        if (p != pages.end()) // another thread read it too
+            return p->second.first;
+        lru.push_front(n);
+        pages.emplace(n, std::make_pair(data, lru.begin()));
+        if (pages.size() > cache_pages) {
+            pages.erase(lru.back());
+            lru.pop_back();
+        }
+        return data;
+    }
+
+    /*
+        Issue reads for the pages of extents which are neither cached nor already
+        being read, but no more than fit in the cache. get_page waits for pages
+        which are still being read.
+    */
+    void file_source::prefetch(const std::vector<byte_extent>& extents) const {
+        std::vector<async_reader::request> requests;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!reader)
+                reader = make_async_reader(fd, use_io_uring);
+            for (const auto& extent : extents) {
+                if (extent.offset >= length || extent.length == 0)
+                    continue;
+                auto last = (std::min<std::uint64_t>(extent.offset + extent.length, length) - 1) / page_size;
+                for (auto n = extent.offset / page_size; n <= last && requests.size() < cache_pages; ++n) {
+                    if (pages.count(n) != 0 || in_flight.count(n) != 0)
+                        continue;
+                    auto begin = n * page_size;
+                    auto data = std::make_shared<std::vector<char>>(std::min<std::uint64_t>(page_size, length - begin));
+                    auto promise = std::make_shared<std::promise<page>>();
+                    in_flight.emplace(n, promise->get_future().share());
+                    requests.push_back(async_reader::request{ begin, data->size(), data->data(),
+                        [this, n, data, promise](long result) {
+                            page p;
+                            {
+                                std::lock_guard<std::mutex> lock(mutex);
+                                in_flight.erase(n);
+                                if (result == static_cast<long>(data->size())) {
+                                    total_read += data->size();
+                                    p = add_page(n, data);
+                                }
+                            }
+                            promise->set_value(p);
+                        } });
+                }
+            }
+        }
+        if (!requests.empty())
+            reader->submit(std::move(requests));
+    }
+
+    /*
+        The chunks are never reallocated, so ranges refer to them without holding
+        the mutex. Bytes beyond length aren't read, so appending can't race with reading.
+    */
+    auto growing_source::read(std::uint64_t offset, std::size_t length) const -> byte_range {
+        std::uint64_t available = this->length;
+        if (offset >= available || length == 0)
+            return byte_range(slice(""));
+        length = static_cast<std::size_t>(std::min<std::uint64_t>(length, available - offset));
+        auto first = offset / chunk_size, last = (offset + length - 1) / chunk_size;
+        std::vector<chunk> parts;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            parts.assign(chunks.begin() + first, chunks.begin() + last + 1);
+        }
+        if (first == last) {
+            auto begin = parts[0]->data() + (offset - first * chunk_size);
+            return byte_range(slice(begin, begin + length), parts[0]);
+        }
+
+        auto copy = std::make_shared<std::vector<char>>(length);
+        for (auto n = first; n <= last; ++n) {
+            auto chunk_begin = n * chunk_size;
+            auto from = std::max(offset, chunk_begin), to = std::min(offset + length, chunk_begin + chunk_size);
+            std::memcpy(copy->data() + (from - offset), parts[n - first]->data() + (from - chunk_begin), to - from);
+        }
+        return byte_range(slice(copy->data(), copy->data() + copy->size()), copy);
+    }
+
+    void growing_source::append(slice part) {
+        std::uint64_t end = length;
+        while (!part.empty()) {
+            auto used = static_cast<std::size_t>(end % chunk_size);
+            chunk c;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (used == 0)
+                    chunks.push_back(std::make_shared<std::vector<char>>(chunk_size));
+                c = chunks.back();
+            }
+            auto n = std::min(part.length(), chunk_size - used);
+            std::memcpy(c->data() + used, part.begin(), n);
+            part = part.skip(n);
+            end += n;
+            length = end;
+        }
+    }
+
+}
@@ -0,0 +1,210 @@
+#ifndef BYTE_SOURCE_HPP
+#define BYTE_SOURCE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "async_reader.hpp"
+#include "mapped_file.hpp"
+#include "pdfp.hpp"
+#include "tools.hpp"
+
+namespace pdf {
+
+    using tools::slice;
+
+    /*
+        Bytes read from a byte_source. When the source had to copy them, storage
+        owns the copy, so data stays valid for as long as the range (or a copy
+        of storage) exists.
+    */
+    struct byte_range {
+        byte_range(slice data, std::shared_ptr<const void> storage = nullptr) : data(data), storage(storage) {}
+        slice data;
+        std::shared_ptr<const void> storage;
+    };
+
+    struct byte_extent {
+        byte_extent(std::uint64_t offset, std::size_t length) : offset(offset), length(length) {}
+        std::uint64_t offset;
+        std::size_t length;
+    };
+
+    // merge extents which overlap, or which are no more than max_gap bytes apart
+    auto coalesce(std::vector<byte_extent> extents, std::uint64_t max_gap = 0) -> std::vector<byte_extent>;
+
+    /*
+        Random access to the contents of a pdf file, which doesn't need to be in
+        memory all at once. Reads may be made from several threads.
+    */
+    class byte_source {
+    public:
+        virtual ~byte_source() {}
+
+        virtual auto size() const noexcept -> std::uint64_t = 0;
+
+        // the bytes in [offset, offset + length), clipped to the end of the source
+        virtual auto read(std::uint64_t offset, std::size_t length) const -> byte_range = 0;
+
+        // true if reading any amount is free, because the whole source is addressable
+        virtual auto in_memory() const noexcept -> bool { return false; }
+
+        // a hint that these extents, sorted by offset, are going to be read soon
+        virtual void prefetch(const std::vector<byte_extent>&) const {}
+
+        // false while more of the source is still to arrive (see growing_source)
+        virtual auto complete() const noexcept -> bool { return true; }
+    };
+
+    const std::size_t initial_window = 1 << 12;
+
+    // how far past its expected end something is still looked for, as offsets may be slightly off
+    const std::size_t window_slack = 1 << 10;
+
+    /*
+        Parse something of unknown length, such as an object, which starts at offset and
+        is expected to end by end. parse is given a window of the source starting at
+        offset, and returns false if it needs to see more of the source. The window grows
+        until parse is satisfied or it covers end (plus some slack), or the end of the
+        source. Parse errors are only passed on once the window can't grow any further.
+    */
+    template <typename Parse>
+    void read_window(const byte_source& source, std::uint64_t offset, std::uint64_t end, Parse parse) {
+        if (offset >= source.size())
+            throw format_error("read_window: invalid offset");
+        end = std::min(std::max(end, offset), source.size());
+        auto length = (source.size() - end > window_slack ? end + window_slack : source.size()) - offset;
+        auto window = source.in_memory() ? length : std::min<std::uint64_t>(initial_window, length);
+        for (;; window = std::min(window * 4, length)) {
+            auto range = source.read(offset, static_cast<std::size_t>(std::min<std::uint64_t>(window, SIZE_MAX)));
+            bool whole = range.data.length() >= length;
+            try {
+                if (parse(range) || whole)
+                    return;
+            } catch (std::runtime_error&) {
+                if (whole)
+                    throw;
+            }
+        }
+    }
+
+    // as above, for something which may extend to the end of the source
+    template <typename Parse>
+    void read_window(const byte_source& source, std::uint64_t offset, Parse parse) {
+        read_window(source, offset, source.size(), parse);
+    }
+
+    /*
+        A pdf which is already in memory.
+    */
+    class memory_source : public byte_source {
+    public:
+        memory_source(slice input) : input(input) {}
+
+        auto size() const noexcept -> std::uint64_t override { return input.length(); }
+        auto read(std::uint64_t offset, std::size_t length) const -> byte_range override;
+        auto in_memory() const noexcept -> bool override { return true; }
+
+    private:
+        const slice input;
+    };
+
+    /*
+        A memory mapped file. Only the pages which are read are loaded by the kernel.
+    */
+    class mapped_source : public byte_source {
+    public:
+        explicit mapped_source(const std::string& filename, access_pattern access = access_pattern::random)
+            : file(filename, access), input(file.data()) {}
+
+        auto size() const noexcept -> std::uint64_t override { return input.length(); }
+        auto read(std::uint64_t offset, std::size_t length) const -> byte_range override;
+        auto in_memory() const noexcept -> bool override { return true; }
+
+    private:
+        mapped_file file;
+        const slice input;
+    };
+
+    /*
+        A file read with pread, for files which can't be mapped, such as those on slow
+        or network storage. The file is read in pages of page_size bytes, the most
+        recently used cache_pages of which are kept. Prefetched pages are read in the
+        background, with io_uring if it is available and use_io_uring is set.
+    */
+    class file_source : public byte_source {
+    public:
+        explicit file_source(const std::string& filename, std::size_t page_size = 1 << 16,
+                             std::size_t cache_pages = 256, bool use_io_uring = true);
+        ~file_source();
+
+        file_source(const file_source&) = delete;
+        file_source& operator=(const file_source&) = delete;
+
+        auto size() const noexcept -> std::uint64_t override { return length; }
+        auto read(std::uint64_t offset, std::size_t length) const -> byte_range override;
+        void prefetch(const std::vector<byte_extent>& extents) const override;
+
+        // the number of bytes read from the file so far
+        auto bytes_read() const -> std::uint64_t;
+
+    private:
+        using page = std::shared_ptr<const std::vector<char>>;
+
+        int fd;
+        std::uint64_t length;
+        const std::size_t page_size;
+        const std::size_t cache_pages;
+        const bool use_io_uring;
+
+        mutable std::mutex mutex;
+        mutable std::list<std::uint64_t> lru; // page numbers, most recently used first
+        mutable std::unordered_map<std::uint64_t, std::pair<page, std::list<std::uint64_t>::iterator>> pages;
+        mutable std::unordered_map<std::uint64_t, std::shared_future<page>> in_flight; // being prefetched
+        mutable std::uint64_t total_read = 0;
+        mutable std::unique_ptr<async_reader> reader;
+
+        auto get_page(std::uint64_t n) const -> page;
+        auto add_page(std::uint64_t n, page p) const -> page;
+    };
+
+    /*
+        A pdf which is still arriving, e.g. being downloaded. Parts of it are appended
+        in order, possibly while other threads read what has already arrived, which is
+        all that size() and read() see. The input is kept in chunks of chunk_size bytes,
+        so a range within a chunk can be returned without copying it.
+    */
+    class growing_source : public byte_source {
+    public:
+        explicit growing_source(std::size_t chunk_size = 1 << 20) : chunk_size(std::max<std::size_t>(chunk_size, 1)) {}
+
+        auto size() const noexcept -> std::uint64_t override { return length; }
+        auto read(std::uint64_t offset, std::size_t length) const -> byte_range override;
+        auto complete() const noexcept -> bool override { return closed; }
+
+        void append(slice part);
+
+        // no more parts are going to be appended
+        void close() noexcept { closed = true; }
+
+    private:
+        using chunk = std::shared_ptr<std::vector<char>>;
+
+        const std::size_t chunk_size;
+        mutable std::mutex mutex;
+        std::vector<chunk> chunks;
+        std::atomic<std::uint64_t> length{ 0 };
+        std::atomic<bool> closed{ false };
+    };
+
+}
+
+#endif
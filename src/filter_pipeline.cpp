@@ -0,0 +1,87 @@
+#include <algorithm>
+
+#include "filter_pipeline.hpp"
+#include "pdf_dictionaries.hpp"
+
+namespace {
+
+    using pdf::tools::variant;
+
+    /*
+        /Filter and /DecodeParms may each be either a single object or an array.
+    */
+    auto as_array(const variant& dict, pdf::atom_type name) -> std::vector<variant> {
+        if (!dict.is_dict() || !dict.haskey(name))
+            return std::vector<variant>();
+        auto value = dict[name];
+        return value.is_array() ? value.get_array() : std::vector<variant>{ value };
+    }
+
+}
+
+namespace pdf {
+
+    filter_pipeline::filter_pipeline(const variant& dict, slice data, std::size_t buffer_size) : data(data) {
+        auto filters = as_array(dict, names::Filter);
+        auto parms = as_array(dict, names::DecodeParms);
+        std::vector<std::unique_ptr<stream_filter>> chain;
+        for (std::size_t i = 0; i < filters.size(); ++i) {
+            auto p = i < parms.size() ? parms[i] : variant();
+            chain.push_back(make_filter(filters[i].get_name(), p));
+            if (p.is_dict() && decode_parms_dict(p).Predictor() != 1)
+                chain.push_back(std::make_unique<predictor_filter>(p));
+        }
+        for (std::size_t i = 0; i < chain.size(); ++i)
+            _stages.push_back(stage{ std::move(chain[i]), tools::ring_buffer(i + 1 < chain.size() ? buffer_size : 0), false });
+    }
+
+    auto filter_pipeline::read(char* output, std::size_t length) -> std::size_t {
+        if (_stages.empty()) {
+            auto n = std::min(length, data.length());
+            std::copy(data.begin(), data.begin() + n, output);
+            data = data.skip(n);
+            return n;
+        }
+        std::size_t total = 0;
+        while (total < length && !_stages.back().done)
+            total += run(_stages.size() - 1, output + total, length - total);
+        return total;
+    }
+
+    auto filter_pipeline::done() const noexcept -> bool {
+        return _stages.empty() ? data.empty() : _stages.back().done;
+    }
+
+    /*
+        Decode into output from stage i, first topping up the buffer it reads from when
+        that is less than half full. Returns once something was written, or the stage is
+        done.
+    */
+    auto filter_pipeline::run(std::size_t i, char* output, std::size_t length) -> std::size_t {
+        auto& s = _stages[i];
+        while (!s.done) {
+            auto input = data;
+            bool last = true;
+            if (i > 0) {
+                auto& source = _stages[i - 1];
+                if (!source.done && (source.buffer.empty() || source.buffer.size() < source.buffer.capacity() / 2)) {
+                    auto back = source.buffer.back();
+                    source.buffer.commit(run(i - 1, back.first, back.second));
+                }
+                input = source.buffer.front();
+                last = source.done && input.length() == source.buffer.size();
+            }
+            auto r = s.filter->decode(input, output, length, last);
+            if (i == 0)
+                data = data.skip(r.consumed);
+            else
+                _stages[i - 1].buffer.consume(r.consumed);
+            // a filter which makes no progress with input left is stuck on damaged data
+            s.done = r.done || (r.consumed == 0 && r.produced == 0 && (last || !input.empty()));
+            if (r.produced > 0)
+                return r.produced;
+        }
+        return 0;
+    }
+
+}
@@ -0,0 +1,52 @@
+#ifndef FILTER_PIPELINE_HPP
+#define FILTER_PIPELINE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "filters.hpp"
+#include "tools.hpp"
+#include "tools/ring_buffer.hpp"
+
+namespace pdf {
+
+    /*
+        Decodes a stream through all of its /Filter entries, and their predictors, as the
+        output is pulled from it. Each stage but the last decodes into a small ring buffer
+        which the next stage reads from, and the last stage decodes straight into the
+        memory passed to read. So memory use doesn't grow with the stream, and a consumer
+        can start on the first part of the data before the rest is decoded.
+    */
+    class filter_pipeline {
+    public:
+        // data must stay valid for the life of the pipeline
+        filter_pipeline(const variant& dict, slice data, std::size_t buffer_size = 1 << 16);
+
+        /*
+            Decode up to length more bytes into output, and return how many were
+            written. Less than length is returned only at the end of the stream.
+        */
+        auto read(char* output, std::size_t length) -> std::size_t;
+
+        auto done() const noexcept -> bool;
+
+        // the number of filters and predictors the data goes through
+        auto stages() const noexcept -> std::size_t { return _stages.size(); }
+
+    private:
+        struct stage {
+            std::unique_ptr<stream_filter> filter;
+            tools::ring_buffer buffer; // its output, unused for the last stage
+            bool done;
+        };
+
+        auto run(std::size_t i, char* output, std::size_t length) -> std::size_t;
+
+        slice data;
+        std::vector<stage> _stages;
+    };
+
+}
+
+#endif
@@ -0,0 +1,893 @@
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+#include <zlib.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define PDFP_SSE2 1
+#endif
+
+#include "filters.hpp"
+#include "filter_pipeline.hpp"
+#include "pdf_dictionaries.hpp"
+
+namespace {
+
+    using pdf::format_error;
+    using pdf::tools::slice;
+    using pdf::tools::variant;
+
+    auto early_change(const variant& parms) -> bool {
+        return !parms.is_dict() || pdf::decode_parms_dict(parms).EarlyChange() != 0;
+    }
+
+    // decode all of data into a vector which starts at size and grows as needed
+    auto decode_vector(pdf::stream_filter& filter, slice data, std::size_t size) -> std::vector<char> {
+        std::vector<char> out(std::max<std::size_t>(size, 1024));
+        std::size_t total = 0;
+        for (;;) {
+            if (total == out.size())
+                out.resize(out.size() * 2);
+            auto r = filter.decode(data, out.data() + total, out.size() - total, true);
+            data = data.skip(r.consumed);
+            total += r.produced;
+            if (r.done)
+                break;
+        }
+        out.resize(total);
+        return out;
+    }
+
+    auto paeth(int a, int b, int c) noexcept -> int {
+        int p = a + b - c;
+        int pa = std::abs(p - a);
+        int pb = std::abs(p - b);
+        int pc = std::abs(p - c);
+        return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+    }
+
+    /*
+        PNG row un-filtering. src is the filtered row, up the previous decoded row
+        (zeros for the first row) and cur receives the decoded row. The scalar
+        loops handle the first pixel outside the loop and are instantiated with
+        the bytes per pixel as a template argument for the common pixel sizes, so
+        the compiler can unroll them; the SSE2 kernels work on whole pixels of 3
+        or 4 bytes. Any other pixel size uses the dynamic instantiation.
+    */
+    using byte_ptr = unsigned char*;
+    using const_byte_ptr = const unsigned char*;
+
+    const std::size_t dynamic_size = 0;
+
+    template <std::size_t N>
+    void unfilter_sub(const_byte_ptr src, byte_ptr cur, std::size_t row, std::size_t bpp) noexcept {
+        if (N != dynamic_size)
+            bpp = N;
+        std::size_t first = std::min(bpp, row);
+        std::copy(src, src + first, cur);
+        for (std::size_t i = first; i < row; ++i)
+            cur[i] = src[i] + cur[i - bpp];
+    }
+
+    void unfilter_up(const_byte_ptr src, const_byte_ptr up, byte_ptr cur, std::size_t row) noexcept {
+        std::size_t i = 0;
+#if PDFP_SSE2
+        for (; i + 16 <= row; i += 16) {
+            auto s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            auto u = _mm_loadu_si128(reinterpret_cast<const __m128i*>(up + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(cur + i), _mm_add_epi8(s, u));
+        }
+#endif
+        for (; i < row; ++i)
+            cur[i] = src[i] + up[i];
+    }
+
+    template <std::size_t N>
+    void unfilter_average(const_byte_ptr src, const_byte_ptr up, byte_ptr cur, std::size_t row, std::size_t bpp) noexcept {
+        if (N != dynamic_size)
+            bpp = N;
+        std::size_t first = std::min(bpp, row);
+        for (std::size_t i = 0; i < first; ++i)
+            cur[i] = src[i] + (up[i] >> 1);
+        for (std::size_t i = first; i < row; ++i)
+            cur[i] = src[i] + ((cur[i - bpp] + up[i]) >> 1);
+    }
+
+    template <std::size_t N>
+    void unfilter_paeth(const_byte_ptr src, const_byte_ptr up, byte_ptr cur, std::size_t row, std::size_t bpp) noexcept {
+        if (N != dynamic_size)
+            bpp = N;
+        std::size_t first = std::min(bpp, row);
+        for (std::size_t i = 0; i < first; ++i)
+            cur[i] = src[i] + up[i];
+        for (std::size_t i = first; i < row; ++i) {
+            int a = cur[i - bpp], b = up[i], c = up[i - bpp];
+            int pa = std::abs(b - c);
+            int pb = std::abs(a - c);
+            int pc = std::abs(a + b - c - c);
+            cur[i] = src[i] + (pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+        }
+    }
+
+#if PDFP_SSE2
+    template <std::size_t width>
+    auto load_pixel(const_byte_ptr p) noexcept -> __m128i {
+        int v = 0;
+        std::memcpy(&v, p, width);
+        return _mm_cvtsi32_si128(v);
+    }
+
+    template <std::size_t width>
+    void store_pixel(byte_ptr p, __m128i v) noexcept {
+        int x = _mm_cvtsi128_si32(v);
+        std::memcpy(p, &x, width);
+    }
+
+    template <std::size_t width>
+    using pixel_width = std::integral_constant<std::size_t, width>;
+
+    /*
+        Calls step(i, width) for each whole pixel of the row from offset i, and
+        returns the offset of the first byte left over. Pixels are moved in and
+        out of registers as 4 bytes while the row has 4 bytes left, which is much
+        cheaper than copying 3; the extra byte stored belongs to the next pixel
+        and is overwritten by it. Bytes in different lanes never mix, so the
+        extra byte does not affect the pixel.
+    */
+    template <std::size_t bpp, typename Step>
+    auto for_each_pixel(std::size_t i, std::size_t row, Step step) -> std::size_t {
+        for (; i + 4 <= row; i += bpp)
+            step(i, pixel_width<4>());
+        for (; i + bpp <= row; i += bpp)
+            step(i, pixel_width<bpp>());
+        return i;
+    }
+
+    // each pixel depends on the one before, so this stays serial, but with one
+    // add per pixel instead of one per byte
+    template <std::size_t bpp>
+    void unfilter_sub_sse2(const_byte_ptr src, byte_ptr cur, std::size_t i, std::size_t row, __m128i a) noexcept {
+        i = for_each_pixel<bpp>(i, row, [&](std::size_t i, auto width) {
+            a = _mm_add_epi8(a, load_pixel<decltype(width)::value>(src + i));
+            store_pixel<decltype(width)::value>(cur + i, a);
+        });
+        for (; i < row; ++i)
+            cur[i] = src[i] + (i < bpp ? 0 : cur[i - bpp]);
+    }
+
+    template <>
+    void unfilter_sub<3>(const_byte_ptr src, byte_ptr cur, std::size_t row, std::size_t) noexcept {
+        unfilter_sub_sse2<3>(src, cur, 0, row, _mm_setzero_si128());
+    }
+
+    template <>
+    void unfilter_sub<4>(const_byte_ptr src, byte_ptr cur, std::size_t row, std::size_t) noexcept {
+        auto a = _mm_setzero_si128();
+        std::size_t i = 0;
+        for (; i + 16 <= row; i += 16) {
+            // prefix sum of the four pixels in the register, plus the last pixel before it
+            auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+            x = _mm_add_epi8(x, a);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(cur + i), x);
+            a = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+        unfilter_sub_sse2<4>(src, cur, i, row, a);
+    }
+
+    template <std::size_t bpp>
+    void unfilter_average_sse2(const_byte_ptr src, const_byte_ptr up, byte_ptr cur, std::size_t row) noexcept {
+        const auto one = _mm_set1_epi8(1);
+        auto a = _mm_setzero_si128();
+        auto i = for_each_pixel<bpp>(0, row, [&](std::size_t i, auto width) {
+            auto b = load_pixel<decltype(width)::value>(up + i);
+            // _mm_avg_epu8 rounds up, the PNG average rounds down
+            auto avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+            a = _mm_add_epi8(load_pixel<decltype(width)::value>(src + i), avg);
+            store_pixel<decltype(width)::value>(cur + i, a);
+        });
+        for (; i < row; ++i)
+            cur[i] = src[i] + (((i < bpp ? 0 : cur[i - bpp]) + up[i]) >> 1);
+    }
+
+    template <>
+    void unfilter_average<3>(const_byte_ptr src, const_byte_ptr up, byte_ptr cur, std::size_t row, std::size_t) noexcept {
+        unfilter_average_sse2<3>(src, up, cur, row);
+    }
+
+    template <>
+    void unfilter_average<4>(const_byte_ptr src, const_byte_ptr up, byte_ptr cur, std::size_t row, std::size_t) noexcept {
+        unfilter_average_sse2<4>(src, up, cur, row);
+    }
+
+    auto abs_epi16(__m128i x) noexcept -> __m128i {
+        auto negative = _mm_cmplt_epi16(x, _mm_setzero_si128());
+        return _mm_sub_epi16(_mm_xor_si128(x, negative), negative);
+    }
+
+    auto select(__m128i mask, __m128i a, __m128i b) noexcept -> __m128i {
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    }
+
+    /*
+        Computes the predictor for all bytes of a pixel at once in 16 bit lanes,
+        without branches. With p = a + b - c, |p - a| = |b - c|, |p - b| = |a - c|
+        and |p - c| = |(a - c) + (b - c)|.
+    */
+    template <std::size_t bpp>
+    void unfilter_paeth_sse2(const_byte_ptr src, const_byte_ptr up, byte_ptr cur, std::size_t row) noexcept {
+        const auto zero = _mm_setzero_si128();
+        auto a = zero, c = zero;
+        auto i = for_each_pixel<bpp>(0, row, [&](std::size_t i, auto width) {
+            auto b = _mm_unpacklo_epi8(load_pixel<decltype(width)::value>(up + i), zero);
+            auto pa = _mm_sub_epi16(b, c);
+            auto pb = _mm_sub_epi16(a, c);
+            auto pc = abs_epi16(_mm_add_epi16(pa, pb));
+            pa = abs_epi16(pa);
+            pb = abs_epi16(pb);
+            auto smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+            auto nearest = select(_mm_cmpeq_epi16(smallest, pa), a, select(_mm_cmpeq_epi16(smallest, pb), b, c));
+            // adding bytes wraps modulo 256 and leaves the high byte of each lane zero
+            a = _mm_add_epi8(_mm_unpacklo_epi8(load_pixel<decltype(width)::value>(src + i), zero), nearest);
+            store_pixel<decltype(width)::value>(cur + i, _mm_packus_epi16(a, a));
+            c = b;
+        });
+        for (; i < row; ++i)
+            cur[i] = src[i] + (i < bpp
+                ? paeth(0, up[i], 0)
+                : paeth(cur[i - bpp], up[i], up[i - bpp]));
+    }
+
+    template <>
+    void unfilter_paeth<3>(const_byte_ptr src, const_byte_ptr up, byte_ptr cur, std::size_t row, std::size_t) noexcept {
+        unfilter_paeth_sse2<3>(src, up, cur, row);
+    }
+
+    template <>
+    void unfilter_paeth<4>(const_byte_ptr src, const_byte_ptr up, byte_ptr cur, std::size_t row, std::size_t) noexcept {
+        unfilter_paeth_sse2<4>(src, up, cur, row);
+    }
+#endif
+
+    using sub_function = void (*)(const_byte_ptr, byte_ptr, std::size_t, std::size_t);
+    using row_function = void (*)(const_byte_ptr, const_byte_ptr, byte_ptr, std::size_t, std::size_t);
+
+    struct png_kernels {
+        sub_function sub;
+        row_function average;
+        row_function paeth;
+    };
+
+    template <std::size_t N>
+    auto kernels() noexcept -> png_kernels {
+        return { unfilter_sub<N>, unfilter_average<N>, unfilter_paeth<N> };
+    }
+
+    auto kernels_for(std::size_t bpp) noexcept -> png_kernels {
+        switch (bpp) {
+            case 1: return kernels<1>();
+            case 2: return kernels<2>();
+            case 3: return kernels<3>();
+            case 4: return kernels<4>();
+            case 6: return kernels<6>();
+            case 8: return kernels<8>();
+            default: return kernels<dynamic_size>();
+        }
+    }
+
+    /*
+        TIFF horizontal differencing (/Predictor 2): each sample is stored as the
+        difference from the same color component of the pixel to its left. The
+        rows are undone in place, with the number of colors as a template
+        argument for the common cases.
+    */
+    template <std::size_t N>
+    void undifference_8(byte_ptr row, std::size_t length, std::size_t colors) noexcept {
+        if (N != dynamic_size)
+            colors = N;
+        for (std::size_t i = colors; i < length; ++i)
+            row[i] += row[i - colors];
+    }
+
+    // 16 bit samples are big-endian
+    template <std::size_t N>
+    void undifference_16(byte_ptr row, std::size_t length, std::size_t colors) noexcept {
+        if (N != dynamic_size)
+            colors = N;
+        for (std::size_t i = 2 * colors; i + 1 < length; i += 2) {
+            unsigned sum = ((row[i] << 8) | row[i + 1]) + ((row[i - 2 * colors] << 8) | row[i - 2 * colors + 1]);
+            row[i] = static_cast<unsigned char>(sum >> 8);
+            row[i + 1] = static_cast<unsigned char>(sum);
+        }
+    }
+
+    // any other sample size, one bit field at a time
+    void undifference_bits(byte_ptr row, std::size_t columns, std::size_t colors, int bpc) noexcept {
+        auto get = [&](std::size_t n) {
+            unsigned value = 0;
+            for (std::size_t bit = n * bpc; bit < (n + 1) * bpc; ++bit)
+                value = (value << 1) | ((row[bit / 8] >> (7 - bit % 8)) & 1);
+            return value;
+        };
+        auto put = [&](std::size_t n, unsigned value) {
+            for (std::size_t bit = (n + 1) * bpc; bit-- > n * bpc; value >>= 1) {
+                auto mask = static_cast<unsigned char>(0x80 >> (bit % 8));
+                row[bit / 8] = (value & 1) ? (row[bit / 8] | mask) : (row[bit / 8] & ~mask);
+            }
+        };
+        for (std::size_t n = colors; n < columns * colors; ++n)
+            put(n, get(n) + get(n - colors));
+    }
+
+    using undifference_function = void (*)(byte_ptr, std::size_t, std::size_t);
+
+    auto tiff_kernel(int bpc, std::size_t colors) noexcept -> undifference_function {
+        if (bpc == 8) {
+            switch (colors) {
+                case 1: return undifference_8<1>;
+                case 3: return undifference_8<3>;
+                case 4: return undifference_8<4>;
+                default: return undifference_8<dynamic_size>;
+            }
+        }
+        if (bpc == 16) {
+            switch (colors) {
+                case 1: return undifference_16<1>;
+                case 3: return undifference_16<3>;
+                case 4: return undifference_16<4>;
+                default: return undifference_16<dynamic_size>;
+            }
+        }
+        return nullptr;
+    }
+
+    // un-filter one PNG row of the given filter type
+    void unfilter_row(int type, const png_kernels& k, const_byte_ptr src, const_byte_ptr up, byte_ptr cur,
+                      std::size_t row, std::size_t bpp) {
+        switch (type) {
+            case 0: std::copy(src, src + row, cur); break;
+            case 1: k.sub(src, cur, row, bpp); break;
+            case 2: unfilter_up(src, up, cur, row); break;
+            case 3: k.average(src, up, cur, row, bpp); break;
+            case 4: k.paeth(src, up, cur, row, bpp); break;
+            default: throw format_error("png_predictor: invalid filter type");
+        }
+    }
+
+    /*
+        Returns the bytes in a row. Each factor is checked before they are multiplied,
+        so hostile values can't overflow the product, or wrap it round to 0.
+    */
+    auto check_predictor(long long colors, long long bpc, long long columns) -> std::size_t {
+        const long long max_bits = 0x1000000;
+        if (colors < 1 || colors > max_bits || bpc < 1 || bpc > 16 || columns < 1 || columns > max_bits
+            || static_cast<std::uint64_t>(colors * bpc) * static_cast<std::uint64_t>(columns) > max_bits)
+            throw format_error("predictor: invalid parameters");
+        return static_cast<std::size_t>((colors * bpc * columns + 7) / 8);
+    }
+
+    auto iswhitespace(char ch) noexcept -> bool {
+        switch (ch) {
+            case 0x00: case 0x09: case 0x0a:
+            case 0x0c: case 0x0d: case 0x20: return true;
+            default: return false;
+        }
+    }
+
+    auto hex_value(char ch) noexcept -> int {
+        if (ch >= '0' && ch <= '9')
+            return ch - '0';
+        ch |= 0x20;
+        return ch >= 'a' && ch <= 'f' ? ch - 'a' + 10 : -1;
+    }
+
+#if PDFP_SSE2
+    // the values of 16 hex digits, and a mask of which characters are hex digits
+    auto hex_values(__m128i x, __m128i& values) noexcept -> int {
+        auto lower = _mm_or_si128(x, _mm_set1_epi8(0x20));
+        auto digit = _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(x, _mm_set1_epi8('9' + 1)));
+        auto letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+        values = _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(x, _mm_set1_epi8('0'))),
+                              _mm_and_si128(letter, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+        return _mm_movemask_epi8(_mm_or_si128(digit, letter));
+    }
+
+    // 16 nibbles to 8 bytes, one in the low half of each 16 bit lane
+    auto hex_pairs(__m128i values) noexcept -> __m128i {
+        return _mm_or_si128(_mm_slli_epi16(_mm_and_si128(values, _mm_set1_epi16(0xff)), 4), _mm_srli_epi16(values, 8));
+    }
+
+    /*
+        Converts 32 hex digits at in to 16 bytes at out. Returns 32 if it did, or
+        otherwise the number of hex digits before the first other character, in
+        which case nothing was written.
+    */
+    auto hex_block(const char* in, char* out) noexcept -> int {
+        __m128i a, b;
+        unsigned mask = hex_values(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)), a)
+                      | hex_values(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16)), b) << 16;
+        if (mask != 0xffffffff)
+            return __builtin_ctz(~mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(hex_pairs(a), hex_pairs(b)));
+        return 32;
+    }
+#endif
+
+    /*
+        Decodes hex digits until either the input or the output runs out, or '>' is
+        read, in which case it returns true. Whitespace is skipped. nibble holds the
+        first digit of a pair which is split between calls.
+    */
+    auto hex_decode(const char*& in, const char* end, char*& out, char* out_end, int& nibble) -> bool {
+        while (in != end && out != out_end) {
+            auto stop = in + 1;
+#if PDFP_SSE2
+            if (nibble < 0 && end - in >= 32 && out_end - out >= 16) {
+                int n = hex_block(in, out);
+                if (n == 32) {
+                    in += 32;
+                    out += 16;
+                    continue;
+                }
+                // the scalar loop takes over up to the character which stopped the block
+                stop = in + n + 1;
+            }
+#endif
+            while (in != stop && out != out_end) {
+                char ch = *in++;
+                int value = hex_value(ch);
+                if (value >= 0) {
+                    if (nibble < 0) {
+                        nibble = value;
+                    } else {
+                        *out++ = static_cast<char>(nibble << 4 | value);
+                        nibble = -1;
+                    }
+                } else if (ch == '>') {
+                    return true;
+                } else if (!iswhitespace(ch)) {
+                    throw format_error("ascii_hex_decode: invalid character");
+                }
+            }
+        }
+        return false;
+    }
+
+    // the number of base-85 digits, not counting whitespace or 'z', among the 16 characters at in
+    auto a85_digits(const char* in) noexcept -> int {
+#if PDFP_SSE2
+        auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        auto digits = _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8('!' - 1)), _mm_cmplt_epi8(x, _mm_set1_epi8('u' + 1)));
+        return __builtin_ctz(~static_cast<unsigned>(_mm_movemask_epi8(digits)));
+#else
+        return static_cast<int>(std::find_if(in, in + 16, [](char ch) { return ch < '!' || ch > 'u'; }) - in);
+#endif
+    }
+
+    // five base-85 digits to four bytes; values past 2^32 - 1 are invalid, and wrap
+    void a85_group(const char* in, char* out) noexcept {
+        std::uint32_t value = 0;
+        for (int i = 0; i < 5; ++i)
+            value = value * 85 + static_cast<std::uint32_t>(in[i] - '!');
+        out[0] = static_cast<char>(value >> 24);
+        out[1] = static_cast<char>(value >> 16);
+        out[2] = static_cast<char>(value >> 8);
+        out[3] = static_cast<char>(value);
+    }
+
+}
+
+namespace pdf {
+
+    auto decode_stream(const variant& dict, slice data) -> std::vector<char> {
+        filter_pipeline pipeline(dict, data);
+        std::vector<char> out(std::max<std::size_t>(decoded_length(dict, data), 1));
+        std::size_t total = 0;
+        while (!pipeline.done()) {
+            if (total == out.size())
+                out.resize(out.size() * 2);
+            total += pipeline.read(out.data() + total, out.size() - total);
+        }
+        out.resize(total);
+        return out;
+    }
+
+    /*
+        What doesn't fit in buffer is decoded into a scratch buffer, to count its length.
+    */
+    auto decode_stream(const variant& dict, slice data, char* buffer, std::size_t length) -> std::size_t {
+        filter_pipeline pipeline(dict, data);
+        auto total = pipeline.read(buffer, length);
+        std::vector<char> scratch;
+        while (!pipeline.done()) {
+            scratch.resize(1 << 16);
+            total += pipeline.read(scratch.data(), scratch.size());
+        }
+        return total;
+    }
+
+    /*
+        If the first guess at the length is too small, the output is moved to twice
+        as much memory, and the memory it leaves behind isn't reused.
+    */
+    auto decode_stream(const variant& dict, slice data, tools::arena& arena) -> slice {
+        filter_pipeline pipeline(dict, data);
+        auto capacity = std::max<std::size_t>(decoded_length(dict, data), 1);
+        auto out = arena.allocate(capacity);
+        std::size_t total = 0;
+        while (!pipeline.done()) {
+            if (total == capacity) {
+                auto larger = arena.allocate(capacity * 2);
+                std::memcpy(larger, out, total);
+                out = larger;
+                capacity *= 2;
+            }
+            total += pipeline.read(out + total, capacity - total);
+        }
+        arena.shrink(out, capacity, total);
+        return total == 0 ? slice("") : slice(out, total);
+    }
+
+    /*
+        Compressed content streams typically shrink to a fifth or less, so without /DL,
+        guess at four times the encoded length.
+    */
+    auto decoded_length(const variant& dict, slice data) -> std::size_t {
+        if (dict.is_dict() && dict.haskey(names::DL) && dict[names::DL].is_integer()) {
+            auto length = dict[names::DL].get_integer();
+            // don't trust a /DL which is implausibly large
+            if (length >= 0 && static_cast<unsigned long long>(length) / 1024 <= data.length() + 1)
+                return static_cast<std::size_t>(length);
+        }
+        if (!dict.is_dict() || !dict.haskey(names::Filter))
+            return data.length();
+        return std::max<std::size_t>(data.length() * 4, 1024);
+    }
+
+    auto make_filter(atom_type name, const variant& parms) -> std::unique_ptr<stream_filter> {
+        switch (name) {
+            case names::FlateDecode: return std::make_unique<flate_filter>();
+            case names::LZWDecode: return std::make_unique<lzw_filter>(early_change(parms));
+            case names::ASCIIHexDecode: return std::make_unique<ascii_hex_filter>();
+            case names::ASCII85Decode: return std::make_unique<ascii85_filter>();
+            default: throw pdf_error("make_filter: unsupported filter");
+        }
+    }
+
+    flate_filter::flate_filter() : zs(new z_stream_s()) {
+        if (inflateInit(zs.get()) != Z_OK)
+            throw pdf_error("flate_filter: inflateInit failed");
+    }
+
+    flate_filter::~flate_filter() {
+        inflateEnd(zs.get());
+    }
+
+    /*
+        Damaged streams are common, so a stream which is truncated or corrupted part way
+        through ends where the damage begins. Data which is damaged from the start is an error.
+    */
+    auto flate_filter::decode(slice input, char* output, std::size_t length, bool last) -> result {
+        if (ended)
+            return result{ 0, 0, true };
+        zs->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.begin()));
+        zs->avail_in = static_cast<uInt>(std::min<std::size_t>(input.length(), UINT_MAX));
+        zs->next_out = reinterpret_cast<Bytef*>(output);
+        zs->avail_out = static_cast<uInt>(std::min<std::size_t>(length, UINT_MAX));
+        auto in = zs->avail_in, out = zs->avail_out;
+        int rc = inflate(zs.get(), Z_NO_FLUSH);
+        result r{ in - zs->avail_in, out - zs->avail_out, false };
+        if (rc == Z_STREAM_END) {
+            ended = true;
+        } else if (rc == Z_BUF_ERROR) {
+            // no progress: with no more input and room to spare, the stream is truncated
+            ended = last && zs->avail_in == 0 && zs->avail_out != 0;
+        } else if (rc != Z_OK) {
+            if (zs->total_out == 0)
+                throw format_error("flate_decode: invalid data");
+            ended = true;
+        }
+        r.done = ended;
+        return r;
+    }
+
+    /*
+        Inflate zlib compressed data. Damaged streams are common, so a stream which
+        is truncated or corrupted part way through returns whatever was decoded.
+    */
+    auto flate_decode(slice data) -> std::vector<char> {
+        flate_filter filter;
+        return decode_vector(filter, data, data.length() * 4);
+    }
+
+    auto lzw_decode(slice data, bool early_change) -> std::vector<char> {
+        lzw_filter filter(early_change);
+        return decode_vector(filter, data, data.length() * 4);
+    }
+
+    auto ascii_hex_decode(slice data) -> std::vector<char> {
+        ascii_hex_filter filter;
+        return decode_vector(filter, data, data.length() / 2);
+    }
+
+    auto ascii85_decode(slice data) -> std::vector<char> {
+        ascii85_filter filter;
+        return decode_vector(filter, data, data.length());
+    }
+
+    auto decode_hexstring(const variant& v) -> std::vector<char> {
+        auto s = v.get_hexstring();
+        if (!s.empty() && s[0] == '<')
+            s = s.rest();
+        std::vector<char> result(s.length() / 2 + 1);
+        auto in = s.begin();
+        auto out = result.data();
+        int nibble = -1;
+        hex_decode(in, s.end(), out, result.data() + result.size(), nibble);
+        if (nibble >= 0)
+            *out++ = static_cast<char>(nibble << 4);
+        result.resize(out - result.data());
+        return result;
+    }
+
+    /*
+        Undo PNG prediction (/Predictor 10 to 15). Every row is preceded by a
+        byte giving the PNG filter type used for that row.
+    */
+    auto png_predictor(slice data, int colors, int bpc, int columns) -> std::vector<char> {
+        auto row = check_predictor(colors, bpc, columns);
+        std::size_t bpp = (colors * bpc + 7) / 8;
+        std::size_t rows = data.length() / (row + 1);
+        std::vector<char> out(rows * row);
+        std::vector<unsigned char> zero(row);
+
+        auto in = reinterpret_cast<const unsigned char*>(data.begin());
+        auto cur = reinterpret_cast<unsigned char*>(out.data());
+        const unsigned char* up = zero.data();
+        auto k = kernels_for(bpp);
+        for (std::size_t r = 0; r < rows; ++r, in += row + 1, up = cur, cur += row)
+            unfilter_row(*in, k, in + 1, up, cur, row, bpp);
+        return out;
+    }
+
+    /*
+        Undo TIFF prediction (/Predictor 2). Rows are packed without any filter
+        byte; a partial row at the end is left as it is.
+    */
+    auto tiff_predictor(slice data, int colors, int bpc, int columns) -> std::vector<char> {
+        auto row = check_predictor(colors, bpc, columns);
+        std::vector<char> out(data.begin(), data.end());
+        auto kernel = tiff_kernel(bpc, colors);
+        auto p = reinterpret_cast<unsigned char*>(out.data());
+        for (std::size_t offset = 0; offset + row <= out.size(); offset += row) {
+            if (kernel)
+                kernel(p + offset, row, colors);
+            else
+                undifference_bits(p + offset, columns, colors, bpc);
+        }
+        return out;
+    }
+
+    predictor_filter::predictor_filter(const variant& parms) {
+        decode_parms_dict p(parms);
+        if (p.Predictor() != 2 && (p.Predictor() < 10 || p.Predictor() > 15))
+            throw pdf_error("predictor_filter: unsupported predictor");
+        // never 0, so decode always has a row to fill, and makes progress
+        row = check_predictor(p.Colors(), p.BitsPerComponent(), p.Columns());
+        // all small enough for int once checked
+        predictor = static_cast<int>(p.Predictor());
+        colors = static_cast<int>(p.Colors());
+        bpc = static_cast<int>(p.BitsPerComponent());
+        columns = static_cast<int>(p.Columns());
+        encoded.resize(predictor == 2 ? row : row + 1);
+        previous.resize(row);
+        current.resize(row);
+    }
+
+    auto predictor_filter::decode(slice input, char* output, std::size_t length, bool last) -> result {
+        result r{ 0, 0, false };
+        for (;;) {
+            auto n = std::min(pending_end - pending_begin, length - r.produced);
+            std::copy(current.data() + pending_begin, current.data() + pending_begin + n, output + r.produced);
+            pending_begin += n;
+            r.produced += n;
+            if (pending_begin != pending_end || ended || r.produced == length)
+                break;
+
+            n = std::min(encoded.size() - filled, input.length() - r.consumed);
+            std::copy(input.begin() + r.consumed, input.begin() + r.consumed + n, encoded.data() + filled);
+            filled += n;
+            r.consumed += n;
+            if (filled < encoded.size()) {
+                if (!last || r.consumed < input.length())
+                    break;
+                // a partial PNG row is dropped, and a partial TIFF row is left as it is
+                if (predictor == 2)
+                    std::copy(encoded.data(), encoded.data() + filled, current.data());
+                pending_begin = 0;
+                pending_end = predictor == 2 ? filled : 0;
+                ended = true;
+                continue;
+            }
+
+            filled = 0;
+            pending_begin = 0;
+            pending_end = row;
+            if (predictor == 2) {
+                std::copy(encoded.begin(), encoded.end(), current.begin());
+                if (auto kernel = tiff_kernel(bpc, colors))
+                    kernel(current.data(), row, colors);
+                else
+                    undifference_bits(current.data(), columns, colors, bpc);
+            } else {
+                std::size_t bpp = (colors * bpc + 7) / 8;
+                std::swap(previous, current);
+                unfilter_row(encoded[0], kernels_for(bpp), encoded.data() + 1, previous.data(), current.data(), row, bpp);
+            }
+        }
+        r.done = ended && pending_begin == pending_end;
+        return r;
+    }
+
+    lzw_filter::lzw_filter(bool early_change) : table(4096), pending(4096), early(early_change ? 1 : 0) {
+        for (unsigned i = 0; i < 256; ++i)
+            table[i] = entry{ 0, 1, static_cast<unsigned char>(i), static_cast<unsigned char>(i) };
+    }
+
+    void lzw_filter::reset() noexcept {
+        width = 9;
+        next = 258;
+        previous = -1;
+    }
+
+    // writes the string for code backwards from output + its length, and returns the length
+    auto lzw_filter::write(unsigned code, char* output) const noexcept -> std::size_t {
+        std::size_t length = table[code].length;
+        auto p = output + length;
+        for (; code > 257; code = table[code].prefix)
+            *--p = static_cast<char>(table[code].last);
+        *--p = static_cast<char>(code);
+        return length;
+    }
+
+    auto lzw_filter::decode(slice input, char* output, std::size_t length, bool last) -> result {
+        result r{ 0, 0, false };
+        auto in = reinterpret_cast<const unsigned char*>(input.begin());
+        for (;;) {
+            if (pending_begin != pending_end) {
+                auto n = std::min(pending_end - pending_begin, length - r.produced);
+                std::copy(pending.data() + pending_begin, pending.data() + pending_begin + n, output + r.produced);
+                pending_begin += n;
+                r.produced += n;
+                if (pending_begin != pending_end)
+                    break;
+            }
+            if (ended || r.produced == length)
+                break;
+            while (bit_count <= 56 && r.consumed < input.length()) {
+                bits = (bits << 8) | in[r.consumed++];
+                bit_count += 8;
+            }
+            if (bit_count < width) {
+                // the stream ends without an end-of-data code
+                ended = last && r.consumed == input.length();
+                break;
+            }
+            unsigned code = (bits >> (bit_count - width)) & ((1u << width) - 1);
+            bit_count -= width;
+            if (code == 256) {
+                reset();
+                continue;
+            }
+            if (code == 257 || code > next || (previous < 0 && code > 255)) {
+                if (code != 257 && total == 0)
+                    throw format_error("lzw_decode: invalid data");
+                ended = true;
+                continue;
+            }
+            if (previous >= 0 && next < table.size()) {
+                // the new string is the previous one followed by the first byte of this one,
+                // which for a code not yet in the table (code == next) is the previous string's
+                auto& prefix = table[previous];
+                table[next] = entry{ static_cast<std::uint16_t>(previous), static_cast<std::uint16_t>(prefix.length + 1),
+                    code == next ? prefix.first : table[code].first, prefix.first };
+                ++next;
+                if (next + early >= (1u << width) && width < 12)
+                    ++width;
+            }
+            previous = code;
+            auto n = table[code].length;
+            if (n <= length - r.produced) {
+                r.produced += write(code, output + r.produced);
+            } else {
+                pending_begin = 0;
+                pending_end = write(code, pending.data());
+            }
+            total += n;
+        }
+        r.done = ended && pending_begin == pending_end;
+        return r;
+    }
+
+    auto ascii_hex_filter::decode(slice input, char* output, std::size_t length, bool last) -> result {
+        auto in = input.begin();
+        auto out = output;
+        if (!ended)
+            ended = hex_decode(in, input.end(), out, output + length, nibble) || (last && in == input.end());
+        // a final odd digit is followed by an implied 0
+        if (ended && nibble >= 0 && out != output + length) {
+            *out++ = static_cast<char>(nibble << 4);
+            nibble = -1;
+        }
+        return result{ static_cast<std::size_t>(in - input.begin()), static_cast<std::size_t>(out - output),
+                       ended && nibble < 0 };
+    }
+
+    auto ascii85_filter::decode(slice input, char* output, std::size_t length, bool last) -> result {
+        auto in = input.begin(), end = input.end();
+        auto out = output, out_end = output + length;
+        auto emit = [&](int n) {
+            char bytes[4];
+            bytes[0] = static_cast<char>(group >> 24);
+            bytes[1] = static_cast<char>(group >> 16);
+            bytes[2] = static_cast<char>(group >> 8);
+            bytes[3] = static_cast<char>(group);
+            std::copy(bytes, bytes + n, pending);
+            pending_begin = 0;
+            pending_end = n;
+            group = 0;
+            count = 0;
+        };
+        // a partial group of n digits is padded with 'u' and gives n - 1 bytes
+        auto finish = [&] {
+            if (count > 1) {
+                int n = count;
+                for (; count < 5; ++count)
+                    group = group * 85 + 84;
+                emit(n - 1);
+            }
+            ended = true;
+        };
+        for (;;) {
+            while (pending_begin != pending_end && out != out_end)
+                *out++ = pending[pending_begin++];
+            if (pending_begin != pending_end || ended || out == out_end)
+                break;
+            if (count == 0 && end - in >= 16 && out_end - out >= 4) {
+                auto groups = std::min<std::ptrdiff_t>(a85_digits(in) / 5, (out_end - out) / 4);
+                for (int i = 0; i < groups; ++i, in += 5, out += 4)
+                    a85_group(in, out);
+                if (groups > 0)
+                    continue;
+            }
+            if (in == end) {
+                if (!last)
+                    break;
+                finish();
+                continue;
+            }
+            char ch = *in++;
+            if (ch == '~') {
+                if (in != end && *in == '>')
+                    ++in;
+                finish();
+            } else if (ch == 'z' && count == 0) {
+                emit(4);
+            } else if (ch >= '!' && ch <= 'u') {
+                group = group * 85 + (ch - '!');
+                if (++count == 5)
+                    emit(4);
+            } else if (!iswhitespace(ch)) {
+                throw format_error("ascii85_decode: invalid character");
+            }
+        }
+        return result{ static_cast<std::size_t>(in - input.begin()), static_cast<std::size_t>(out - output),
+                       ended && pending_begin == pending_end };
+    }
+
+}
@@ -0,0 +1,177 @@
+#ifndef FILTERS_HPP
+#define FILTERS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "tools.hpp"
+#include "tools/arena.hpp"
+
+struct z_stream_s;
+
+namespace pdf {
+
+    using tools::slice;
+    using tools::variant;
+
+    /*
+        Decodes a stream incrementally. Input and output can be supplied in parts of any
+        size: decode uses as much of the input and fills as much of the output as it can,
+        and is called again with the rest of the input, or more room for output, until
+        the end of the stream is reached.
+    */
+    class stream_filter {
+    public:
+        virtual ~stream_filter() {}
+
+        struct result {
+            std::size_t consumed; // bytes of input used
+            std::size_t produced; // bytes of output written
+            bool done; // the end of the stream was reached, or the rest of it is damaged
+        };
+
+        // last is set when input holds the rest of the encoded data
+        virtual auto decode(slice input, char* output, std::size_t length, bool last) -> result = 0;
+    };
+
+    class flate_filter : public stream_filter {
+    public:
+        flate_filter();
+        ~flate_filter();
+
+        flate_filter(const flate_filter&) = delete;
+        auto operator=(const flate_filter&) -> flate_filter& = delete;
+
+        auto decode(slice input, char* output, std::size_t length, bool last) -> result override;
+
+    private:
+        std::unique_ptr<z_stream_s> zs;
+        bool ended = false;
+    };
+
+    /*
+        LZWDecode. Codes are taken from a 64 bit buffer which is refilled only when it
+        runs low, and the code table is a fixed array of entries which each refer to
+        their prefix, so strings are written backwards straight into the output and
+        nothing is allocated while decoding. early_change is /EarlyChange: whether
+        the code width grows one code early.
+    */
+    class lzw_filter : public stream_filter {
+    public:
+        explicit lzw_filter(bool early_change = true);
+
+        auto decode(slice input, char* output, std::size_t length, bool last) -> result override;
+
+    private:
+        struct entry {
+            std::uint16_t prefix;
+            std::uint16_t length;
+            unsigned char last; // the final byte of the string
+            unsigned char first;
+        };
+
+        void reset() noexcept;
+        auto write(unsigned code, char* output) const noexcept -> std::size_t;
+
+        std::vector<entry> table;
+        std::vector<char> pending; // the part of a string which didn't fit the output
+        std::size_t pending_begin = 0, pending_end = 0;
+        std::uint64_t bits = 0;
+        int bit_count = 0;
+        int width = 9;
+        unsigned next = 258;
+        int previous = -1; // the last code, or -1 after a clear code
+        int early;
+        std::size_t total = 0;
+        bool ended = false;
+    };
+
+    /*
+        ASCIIHexDecode. Runs of 32 hex digits are converted 16 bytes at a time with
+        SSE2 where available; whitespace and the rest go through the scalar loop.
+    */
+    class ascii_hex_filter : public stream_filter {
+    public:
+        auto decode(slice input, char* output, std::size_t length, bool last) -> result override;
+
+    private:
+        int nibble = -1; // the first digit of an incomplete pair
+        bool ended = false;
+    };
+
+    /*
+        ASCII85Decode. Runs of up to three groups without whitespace or 'z' are found
+        16 characters at a time and decoded without any per-character tests.
+    */
+    class ascii85_filter : public stream_filter {
+    public:
+        auto decode(slice input, char* output, std::size_t length, bool last) -> result override;
+
+    private:
+        std::uint64_t group = 0;
+        int count = 0; // characters in group
+        char pending[4];
+        int pending_begin = 0, pending_end = 0; // decoded bytes which didn't fit the output
+        bool ended = false;
+    };
+
+    /*
+        Undoes the /Predictor given in a /DecodeParms dictionary a row at a time, so a
+        predictor can follow its filter in a filter_pipeline.
+    */
+    class predictor_filter : public stream_filter {
+    public:
+        explicit predictor_filter(const variant& parms);
+
+        auto decode(slice input, char* output, std::size_t length, bool last) -> result override;
+
+    private:
+        int predictor, colors, bpc, columns;
+        std::size_t row; // bytes in a decoded row
+        std::vector<unsigned char> encoded; // the row being read, starting with its PNG filter type
+        std::size_t filled = 0;
+        std::vector<unsigned char> previous, current; // decoded rows
+        std::size_t pending_begin = 0, pending_end = 0; // the part of current still to be written
+        bool ended = false;
+    };
+
+    // a filter for /Filter name with its /DecodeParms, which throws pdf_error if it isn't supported
+    auto make_filter(atom_type name, const variant& parms = variant()) -> std::unique_ptr<stream_filter>;
+
+    /*
+        Decode stream data as specified by the /Filter and /DecodeParms entries
+        of the stream's dictionary.
+    */
+    auto decode_stream(const variant& dict, slice data) -> std::vector<char>;
+
+    /*
+        As above, but into buffer, which has room for length bytes. Returns the decoded
+        length, which is more than length if buffer was too small, in which case only
+        the first length bytes are written. The last filter decodes straight into buffer.
+    */
+    auto decode_stream(const variant& dict, slice data, char* buffer, std::size_t length) -> std::size_t;
+
+    /*
+        As above, but into memory allocated from an arena, starting with the amount
+        given by decoded_length.
+    */
+    auto decode_stream(const variant& dict, slice data, tools::arena& arena) -> slice;
+
+    // the decoded length of a stream: its /DL entry, or otherwise a guess based on data
+    auto decoded_length(const variant& dict, slice data) -> std::size_t;
+
+    auto flate_decode(slice data) -> std::vector<char>;
+    auto lzw_decode(slice data, bool early_change = true) -> std::vector<char>;
+    auto ascii_hex_decode(slice data) -> std::vector<char>;
+    auto ascii85_decode(slice data) -> std::vector<char>;
+
+    // the bytes of a hexstring, which the parser keeps as it appears in the file
+    auto decode_hexstring(const variant& v) -> std::vector<char>;
+    auto png_predictor(slice data, int colors, int bpc, int columns) -> std::vector<char>;
+    auto tiff_predictor(slice data, int colors, int bpc, int columns) -> std::vector<char>;
+
+}
+
+#endif
@@ -0,0 +1,209 @@
+#include "hint_tables.hpp"
+#include "filters.hpp"
+#include "pdf_dictionaries.hpp"
+
+namespace {
+
+    using pdf::format_error;
+    using pdf::tools::slice;
+
+    /*
+        Reads unsigned fields of up to 32 bits, most significant bit first.
+    */
+    class bit_reader {
+    public:
+        bit_reader(slice data) : data(data) {}
+
+        auto read(unsigned bits) -> std::uint64_t {
+            if (bits > 32)
+                throw format_error("hint_tables: field too wide");
+            if (bits > data.length() * 8 - position)
+                throw format_error("hint_tables: table too short");
+            std::uint64_t value = 0;
+            for (; bits > 0; --bits, ++position)
+                value = value << 1 | ((static_cast<unsigned char>(data[position / 8]) >> (7 - position % 8)) & 1);
+            return value;
+        }
+
+        // every item starts on a byte boundary
+        void align() noexcept {
+            position = (position + 7) / 8 * 8;
+        }
+
+    private:
+        slice data;
+        std::size_t position = 0; // in bits
+    };
+
+    // offsets in hint tables are as if the hint stream weren't there
+    auto adjust(std::uint64_t offset, std::uint64_t hint_offset, std::uint64_t hint_length) noexcept -> std::uint64_t {
+        return offset >= hint_offset ? offset + hint_length : offset;
+    }
+
+    // read an item for every entry, as the least value plus a difference of bits bits
+    template <typename Entry, typename Set>
+    void read_item(bit_reader& bits, std::vector<Entry>& entries, unsigned width, Set set) {
+        for (auto& entry : entries)
+            set(entry, bits.read(width));
+        bits.align();
+    }
+
+}
+
+namespace pdf {
+
+    hint_tables::hint_tables(const indirect_object& stream, const variant& params) {
+        if (!stream.stream || !stream.object.is_dict())
+            throw format_error("hint_tables: not a stream");
+        linearization_dict lin(params);
+        auto h = lin.H();
+        if (h.size() < 2 || h[0] < 0 || h[1] < 0 || lin.N() <= 0 || lin.N() > 0xffffff)
+            throw format_error("hint_tables: invalid linearization dictionary");
+        pdf_dict dict(stream.object);
+        auto shared_offset = dict.get_integer(names::S, -1);
+        auto data = decode_stream(stream.object, *stream.stream);
+        if (shared_offset < 0 || static_cast<std::uint64_t>(shared_offset) > data.size())
+            throw format_error("hint_tables: invalid shared object table offset");
+
+        // every page takes at least a bit of the table, so /N can't make us allocate much more than it
+        if (static_cast<std::uint64_t>(lin.N()) > data.size() * 8)
+            throw format_error("hint_tables: table too short for /N pages");
+
+        slice all = data.empty() ? slice("") : slice(data.data(), data.size());
+        pages.resize(static_cast<std::size_t>(lin.N()));
+        read_page_offsets(all, h[0], h[1]);
+        read_shared_objects(all.skip(static_cast<std::size_t>(shared_offset)), h[0], h[1]);
+        for (const auto& page : pages)
+            for (auto group : page.shared)
+                if (group >= groups.size())
+                    throw format_error("hint_tables: invalid shared object reference");
+    }
+
+    auto hint_tables::page(unsigned n) const -> const page_hint& {
+        if (n >= pages.size())
+            throw format_error("hint_tables::page: no such page");
+        return pages[n];
+    }
+
+    auto hint_tables::shared(unsigned i) const -> const shared_hint& {
+        if (i >= groups.size())
+            throw format_error("hint_tables::shared: no such shared object group");
+        return groups[i];
+    }
+
+    /*
+        Groups used by the first page are part of it, so the first page's extent
+        stands in for them.
+    */
+    auto hint_tables::page_extents(unsigned n) const -> std::vector<byte_extent> {
+        const auto& hint = page(n);
+        std::vector<byte_extent> extents = { byte_extent(hint.offset, static_cast<std::size_t>(hint.length)) };
+        for (auto i : hint.shared) {
+            const auto& group = groups[i];
+            if (group.first_page)
+                extents.emplace_back(pages[0].offset, static_cast<std::size_t>(pages[0].length));
+            else
+                extents.emplace_back(group.offset, static_cast<std::size_t>(group.length));
+        }
+        return coalesce(extents);
+    }
+
+    /*
+        The page offset hint table (see table F.3 and F.4 of the PDF 1.7 specification).
+    */
+    void hint_tables::read_page_offsets(slice data, std::uint64_t hint_offset, std::uint64_t hint_length) {
+        bit_reader bits(data);
+        auto least_objects = bits.read(32);
+        auto first_page_offset = bits.read(32);
+        auto objects_bits = bits.read(16);
+        auto least_length = bits.read(32);
+        auto length_bits = bits.read(16);
+        auto least_content_offset = bits.read(32);
+        auto content_offset_bits = bits.read(16);
+        auto least_content_length = bits.read(32);
+        auto content_length_bits = bits.read(16);
+        auto shared_count_bits = bits.read(16);
+        auto shared_id_bits = bits.read(16);
+        auto numerator_bits = bits.read(16);
+        bits.read(16); // the denominator of the fractional positions, which aren't used
+
+        read_item(bits, pages, objects_bits, [&](page_hint& page, std::uint64_t v) {
+            page.objects = static_cast<unsigned>(least_objects + v);
+        });
+        read_item(bits, pages, length_bits, [&](page_hint& page, std::uint64_t v) {
+            page.length = least_length + v;
+        });
+        read_item(bits, pages, shared_count_bits, [&](page_hint& page, std::uint64_t v) {
+            if (v > data.length() * 8)
+                throw format_error("hint_tables: too many shared objects");
+            page.shared.resize(static_cast<std::size_t>(v));
+        });
+        for (auto& page : pages)
+            for (auto& group : page.shared)
+                group = static_cast<unsigned>(bits.read(shared_id_bits));
+        bits.align();
+        for (auto& page : pages)
+            for (std::size_t i = 0; i < page.shared.size(); ++i)
+                bits.read(numerator_bits);
+        bits.align();
+        read_item(bits, pages, content_offset_bits, [&](page_hint& page, std::uint64_t v) {
+            page.content_offset = least_content_offset + v;
+        });
+        read_item(bits, pages, content_length_bits, [&](page_hint& page, std::uint64_t v) {
+            page.content_length = least_content_length + v;
+        });
+
+        // pages follow one another, starting with the first
+        auto offset = first_page_offset;
+        for (auto& page : pages) {
+            page.offset = adjust(offset, hint_offset, hint_length);
+            offset += page.length;
+        }
+    }
+
+    /*
+        The shared object hint table (see table F.5 and F.6 of the PDF 1.7 specification).
+        The first groups are in the first page, and the rest in the shared objects section.
+    */
+    void hint_tables::read_shared_objects(slice data, std::uint64_t hint_offset, std::uint64_t hint_length) {
+        bit_reader bits(data);
+        auto first_object = bits.read(32);
+        auto first_offset = bits.read(32);
+        auto first_page_groups = bits.read(32);
+        auto total_groups = bits.read(32);
+        auto objects_bits = bits.read(16);
+        auto least_length = bits.read(32);
+        auto length_bits = bits.read(16);
+        if (first_page_groups > total_groups || total_groups > data.length() * 8)
+            throw format_error("hint_tables: invalid shared object table");
+
+        groups.resize(static_cast<std::size_t>(total_groups));
+        read_item(bits, groups, length_bits, [&](shared_hint& group, std::uint64_t v) {
+            group.length = least_length + v;
+        });
+        std::vector<bool> signatures;
+        read_item(bits, groups, 1, [&](shared_hint&, std::uint64_t v) { signatures.push_back(v != 0); });
+        for (auto signature : signatures)
+            if (signature) // a 128 bit MD5 signature, which isn't checked
+                for (int i = 0; i < 4; ++i)
+                    bits.read(32);
+        read_item(bits, groups, objects_bits, [&](shared_hint& group, std::uint64_t v) {
+            group.objects = static_cast<unsigned>(v + 1);
+        });
+
+        // groups in the shared objects section follow one another, as do their objects
+        auto offset = first_offset;
+        auto object = first_object;
+        for (std::size_t i = 0; i < groups.size(); ++i) {
+            auto& group = groups[i];
+            group.first_page = i < first_page_groups;
+            if (group.first_page)
+                continue;
+            group.offset = adjust(offset, hint_offset, hint_length);
+            group.first_object = static_cast<unsigned>(object);
+            offset += group.length;
+            object += group.objects;
+        }
+    }
+
+}
@@ -0,0 +1,66 @@
+#ifndef HINT_TABLES_HPP
+#define HINT_TABLES_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "byte_source.hpp"
+#include "parser.hpp"
+#include "tools.hpp"
+
+namespace pdf {
+
+    using tools::variant;
+
+    struct page_hint {
+        std::uint64_t offset = 0; // of the page's first object
+        std::uint64_t length = 0; // of all of the page's objects
+        unsigned objects = 0; // the number of objects
+        std::vector<unsigned> shared; // the shared object groups the page uses
+        std::uint64_t content_offset = 0; // of the page's content stream, relative to offset
+        std::uint64_t content_length = 0;
+    };
+
+    struct shared_hint {
+        std::uint64_t offset = 0; // of the group's first object
+        std::uint64_t length = 0; // of all of the group's objects
+        unsigned first_object = 0; // the object number of the group's first object
+        unsigned objects = 0; // the number of objects in the group
+        bool first_page = false; // the group is part of the first page
+    };
+
+    /*
+        The page offset and shared object hint tables of a linearized file, from its
+        primary hint stream. The tables are bit-packed: each table has a header of the
+        least value of each item and the number of bits needed for the difference from
+        it, followed by the differences, item by item for every entry in turn. They are
+        decoded once, when the hint_tables are constructed.
+
+        Offsets in the tables disregard the hint stream itself. They are adjusted here,
+        so the offsets of the hints are file offsets.
+    */
+    class hint_tables {
+    public:
+        // stream is the primary hint stream of a file whose linearization dictionary is params
+        hint_tables(const indirect_object& stream, const variant& params);
+
+        auto page_count() const noexcept -> unsigned { return pages.size(); }
+        auto page(unsigned n) const -> const page_hint&;
+
+        auto shared_count() const noexcept -> unsigned { return groups.size(); }
+        auto shared(unsigned i) const -> const shared_hint&;
+
+        // the parts of the file holding page n and the shared objects it uses, sorted by offset
+        auto page_extents(unsigned n) const -> std::vector<byte_extent>;
+
+    private:
+        std::vector<page_hint> pages;
+        std::vector<shared_hint> groups;
+
+        void read_page_offsets(slice data, std::uint64_t hint_offset, std::uint64_t hint_length);
+        void read_shared_objects(slice data, std::uint64_t hint_offset, std::uint64_t hint_length);
+    };
+
+}
+
+#endif
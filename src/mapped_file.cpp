@@ -0,0 +1,88 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <limits>
+
+#include "mapped_file.hpp"
+#include "pdfp.hpp"
+
+namespace {
+
+    auto advice(pdf::access_pattern access) noexcept -> int {
+        switch (access) {
+            case pdf::access_pattern::sequential: return MADV_SEQUENTIAL;
+            case pdf::access_pattern::random: return MADV_RANDOM;
+            default: return MADV_NORMAL;
+        }
+    }
+
+}
+
+namespace pdf {
+
+    mapped_file::mapped_file(const std::string& filename, access_pattern access, bool populate) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw pdf_error("mapped_file: can't open file");
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw pdf_error("mapped_file: can't stat file");
+        }
+        if (static_cast<unsigned long long>(st.st_size) > std::numeric_limits<std::size_t>::max()) {
+            close(fd);
+            throw pdf_error("mapped_file: file too large");
+        }
+        length = static_cast<std::size_t>(st.st_size);
+        if (length == 0) {
+            close(fd);
+            return;
+        }
+
+        int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+        if (populate)
+            flags |= MAP_POPULATE;
+#else
+        (void)populate;
+#endif
+        void* p = mmap(nullptr, length, PROT_READ, flags, fd, 0);
+        // the mapping keeps its own reference to the file
+        close(fd);
+        if (p == MAP_FAILED)
+            throw pdf_error("mapped_file: mmap failed");
+        address = static_cast<const char*>(p);
+        // only a hint, so failure doesn't matter
+        madvise(p, length, advice(access));
+    }
+
+    mapped_file::~mapped_file() {
+        unmap();
+    }
+
+    mapped_file::mapped_file(mapped_file&& src) noexcept : address(src.address), length(src.length) {
+        src.address = nullptr;
+        src.length = 0;
+    }
+
+    mapped_file& mapped_file::operator=(mapped_file&& src) noexcept {
+        if (this != &src) {
+            unmap();
+            address = src.address;
+            length = src.length;
+            src.address = nullptr;
+            src.length = 0;
+        }
+        return *this;
+    }
+
+    void mapped_file::unmap() noexcept {
+        if (address != nullptr)
+            munmap(const_cast<char*>(address), length);
+        address = nullptr;
+        length = 0;
+    }
+
+}
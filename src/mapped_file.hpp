@@ -0,0 +1,49 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <string>
+
+#include "tools.hpp"
+
+namespace pdf {
+
+    using tools::slice;
+
+    // how a mapped file is going to be read, passed on to the kernel with madvise
+    enum class access_pattern {
+        normal,
+        sequential, // e.g. scanning a damaged file for objects
+        random      // e.g. loading objects through the xref table
+    };
+
+    /*
+        A read-only memory mapping of an entire file. Pages are only read from disk
+        when they are first touched, unless populate is set, in which case the whole
+        file is read in up front (where MAP_POPULATE is supported).
+    */
+    class mapped_file {
+    public:
+        mapped_file() {}
+        explicit mapped_file(const std::string& filename, access_pattern access = access_pattern::normal,
+                             bool populate = false);
+        ~mapped_file();
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        mapped_file(mapped_file&& src) noexcept;
+        mapped_file& operator=(mapped_file&& src) noexcept;
+
+        auto data() const noexcept -> slice { return length == 0 ? slice("") : slice(address, address + length); }
+        auto size() const noexcept -> std::size_t { return length; }
+
+    private:
+        const char* address = nullptr;
+        std::size_t length = 0;
+
+        void unmap() noexcept;
+    };
+
+}
+
+#endif
@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <unordered_set>
+
+#include "object_loader.hpp"
+
+namespace pdf {
+
+    namespace {
+
+        // get_all reads across gaps up to this size between objects...
+        const std::uint64_t max_gap = 1 << 16;
+        // ...as long as a single read doesn't get larger than this
+        const std::uint64_t max_read = 1 << 24;
+
+    }
+
+    /*
+        Free and missing objects are null objects.
+    */
+    auto object_loader::get(objref ref) -> indirect_object {
+        auto entry = xref[ref.id];
+        switch (entry.type()) {
+            case xref_type::in_use: {
+                auto object = load(entry.offset());
+                if (object.ref.id != ref.id)
+                    throw format_error("object_loader::get: wrong object at offset");
+                return object;
+            }
+            case xref_type::compressed: {
+                const auto& stream = get_object_stream(entry.stream());
+                unsigned index = entry.index();
+                // the index is only a hint: find the object if it isn't where it should be
+                if (index >= stream.size() || stream.id(index) != static_cast<unsigned>(ref.id))
+                    for (index = 0; index < stream.size() && stream.id(index) != static_cast<unsigned>(ref.id); ++index)
+                        ;
+                if (index == stream.size())
+                    throw format_error("object_loader::get: object not in object stream");
+                return indirect_object(objref(ref.id, 0), stream.get(index));
+            }
+            default:
+                return indirect_object(ref, variant::make_null());
+        }
+    }
+
+    /*
+        The objects (or the object streams holding them) are sorted by offset, and
+        runs of them with gaps of no more than max_gap bytes between them are read
+        with a single read of up to max_read bytes.
+    */
+    auto object_loader::get_all(const std::vector<objref>& refs) -> std::vector<indirect_object> {
+        struct pending {
+            unsigned id;
+            byte_extent extent;
+            bool object_stream;
+        };
+        std::vector<pending> loads;
+        std::unordered_set<unsigned> seen;
+        for (auto ref : refs) {
+            unsigned id = ref.id;
+            auto entry = xref[id];
+            bool compressed = entry.type() == xref_type::compressed;
+            if (compressed) {
+                id = entry.stream();
+                if (object_streams.count(id) != 0)
+                    continue;
+                entry = xref[id];
+            }
+            if (entry.type() != xref_type::in_use || entry.offset() >= source.size() || !seen.insert(id).second)
+                continue;
+            loads.push_back(pending{ id, extent(entry.offset()), compressed });
+        }
+        std::sort(loads.begin(), loads.end(),
+                  [](const pending& a, const pending& b) { return a.extent.offset < b.extent.offset; });
+
+        std::unordered_map<unsigned, indirect_object> loaded;
+        for (std::size_t first = 0, last; first < loads.size(); first = last) {
+            auto begin = loads[first].extent.offset;
+            auto end = begin + loads[first].extent.length;
+            for (last = first + 1; last < loads.size(); ++last) {
+                auto next = loads[last].extent;
+                if (next.offset > end + max_gap || next.offset + next.length - begin > max_read)
+                    break;
+                end = std::max<std::uint64_t>(end, next.offset + next.length);
+            }
+            auto range = source.read(begin, static_cast<std::size_t>(end - begin));
+            for (auto i = first; i < last; ++i) {
+                auto offset = loads[i].extent.offset;
+                auto object = load(range, static_cast<std::size_t>(offset - begin), offset);
+                if (loads[i].object_stream)
+                    object_streams[loads[i].id] = std::make_unique<object_stream>(object);
+                else
+                    loaded.emplace(loads[i].id, object);
+            }
+        }
+
+        std::vector<indirect_object> result;
+        for (auto ref : refs) {
+            auto object = loaded.find(ref.id);
+            if (object == loaded.end() || xref[ref.id].type() != xref_type::in_use)
+                result.push_back(get(ref));
+            else if (object->second.ref.id != ref.id)
+                throw format_error("object_loader::get_all: wrong object at offset");
+            else
+                result.push_back(object->second);
+        }
+        return result;
+    }
+
+    /*
+        Objects (or the object streams holding them) are passed to the source in
+        file order, so they can be read with as little seeking as possible.
+    */
+    void object_loader::prefetch(const std::vector<objref>& refs) {
+        std::vector<byte_extent> extents;
+        std::unordered_set<unsigned> streams;
+        for (auto ref : refs) {
+            auto entry = xref[ref.id];
+            if (entry.type() == xref_type::compressed) {
+                if (object_streams.count(entry.stream()) != 0 || !streams.insert(entry.stream()).second)
+                    continue;
+                entry = xref[entry.stream()];
+            }
+            if (entry.type() != xref_type::in_use || entry.offset() >= source.size())
+                continue;
+            extents.push_back(extent(entry.offset()));
+        }
+        std::sort(extents.begin(), extents.end(),
+                  [](const byte_extent& a, const byte_extent& b) { return a.offset < b.offset; });
+        source.prefetch(extents);
+    }
+
+    /*
+        An object is assumed to extend up to the next object in the file.
+    */
+    auto object_loader::extent(std::uint64_t offset) -> byte_extent {
+        if (offsets.empty()) {
+            for (unsigned id = 0; id < xref.size(); ++id)
+                if (xref[id].type() == xref_type::in_use)
+                    offsets.push_back(xref[id].offset());
+            std::sort(offsets.begin(), offsets.end());
+        }
+        auto next = std::upper_bound(offsets.begin(), offsets.end(), offset);
+        auto end = next == offsets.end() ? source.size() : std::min(*next, source.size());
+        return byte_extent(offset, static_cast<std::size_t>(end - offset));
+    }
+
+    auto object_loader::load(std::uint64_t offset) -> indirect_object {
+        if (offset >= source.size())
+            throw format_error("object_loader::load: invalid offset");
+        indirect_object object(objref(), variant::make_null());
+        // a damaged object doesn't get to read the rest of the file
+        auto e = extent(offset);
+        read_window(source, offset, offset + e.length, [&](const byte_range& window) {
+            return parse(window, window.data, object);
+        });
+        return object;
+    }
+
+    /*
+        Parse the object at offset, which lies skip bytes into range. If range
+        turns out not to hold all of it, the object is read on its own.
+    */
+    auto object_loader::load(const byte_range& range, std::size_t skip, std::uint64_t offset) -> indirect_object {
+        indirect_object object(objref(), variant::make_null());
+        try {
+            if (parse(range, range.data.skip(skip), object))
+                return object;
+        } catch (std::runtime_error&) {
+            // try again below
+        }
+        return load(offset);
+    }
+
+    // parse the object at the start of input, which lies within range
+    auto object_loader::parse(const byte_range& range, slice input, indirect_object& object) -> bool {
+        tools::atom_table tab;
+        parser p(input, tab);
+        object = p.expect_indirect_object([this](objref ref) { return resolve_length(ref); });
+        object.storage = range.storage;
+        // running into the end of the range means the object may be incomplete
+        return !p.remainder().empty();
+    }
+
+    auto object_loader::get_object_stream(unsigned id) -> const object_stream& {
+        auto stream = object_streams.find(id);
+        if (stream != object_streams.end())
+            return *stream->second;
+        // object streams can't be stored in object streams
+        auto entry = xref[id];
+        if (entry.type() != xref_type::in_use)
+            throw format_error("object_loader::get_object_stream: missing object stream");
+        auto object = load(entry.offset());
+        return *(object_streams[id] = std::make_unique<object_stream>(object));
+    }
+
+    /*
+        Returning -1 makes the parser scan for endstream instead. That is also what
+        happens if the /Length object is itself a stream with an indirect /Length,
+        which would otherwise recurse (possibly forever).
+    */
+    auto object_loader::resolve_length(objref ref) -> long long {
+        if (resolving_length)
+            return -1;
+        resolving_length = true;
+        long long length = -1;
+        try {
+            auto object = get(ref).object;
+            if (object.is_integer())
+                length = object.get_integer();
+        } catch (format_error&) {
+            // fall through and scan
+        } catch (...) {
+            resolving_length = false;
+            throw;
+        }
+        resolving_length = false;
+        return length;
+    }
+
+}
@@ -0,0 +1,57 @@
+#ifndef OBJECT_LOADER_HPP
+#define OBJECT_LOADER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "byte_source.hpp"
+#include "tools.hpp"
+#include "object_stream.hpp"
+#include "parser.hpp"
+#include "xref_table.hpp"
+
+namespace pdf {
+
+    using tools::objref;
+    using tools::slice;
+
+    /*
+        Loads indirect objects, wherever the xref table says they are.
+        Object streams are decoded the first time one of their objects is needed
+        and kept for the lifetime of the loader.
+    */
+    class object_loader {
+    public:
+        object_loader(const byte_source& source, const xref_table& xref) : source(source), xref(xref) {}
+        object_loader(slice input, const xref_table& xref)
+            : owned(new memory_source(input)), source(*owned), xref(xref) {}
+
+        auto get(objref ref) -> indirect_object;
+
+        // get all these objects (in the same order), reading them in file order
+        auto get_all(const std::vector<objref>& refs) -> std::vector<indirect_object>;
+
+        // start reading these objects in the background, so that getting them later doesn't wait
+        void prefetch(const std::vector<objref>& refs);
+
+    private:
+        std::unique_ptr<byte_source> owned; // when constructed from a slice
+        const byte_source& source; // entire pdf file
+        const xref_table& xref;
+        std::unordered_map<unsigned, std::unique_ptr<object_stream>> object_streams;
+        bool resolving_length = false;
+        std::vector<std::uint64_t> offsets; // of every object in the file, sorted
+
+        auto extent(std::uint64_t offset) -> byte_extent;
+        auto load(std::uint64_t offset) -> indirect_object;
+        auto load(const byte_range& range, std::size_t skip, std::uint64_t offset) -> indirect_object;
+        auto parse(const byte_range& range, slice input, indirect_object& object) -> bool;
+        auto get_object_stream(unsigned id) -> const object_stream&;
+        auto resolve_length(objref ref) -> long long;
+    };
+
+}
+
+#endif
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <limits>
+
+#include "object_stream.hpp"
+#include "filters.hpp"
+#include "pdf_dictionaries.hpp"
+
+namespace pdf {
+
+    object_stream::object_stream(const indirect_object& stream) {
+        if (!stream.stream || !stream.object.is_dict())
+            throw format_error("object_stream: not a stream");
+        pdf_dict dict(stream.object);
+        if (dict.get_name(names::Type) != names::ObjStm)
+            throw format_error("object_stream: not an object stream");
+        auto n = dict.get_integer(names::N, -1);
+        auto first = dict.get_integer(names::First, -1);
+        data = decode_stream(stream.object, *stream.stream);
+        if (n < 0 || first < 0 || static_cast<unsigned long long>(first) > data.size())
+            throw format_error("object_stream: invalid /N or /First");
+
+        tools::atom_table tab;
+        parser p(data.empty() ? slice("") : slice(data.data(), data.data() + first), tab);
+        for (long long i = 0; i < n; ++i) {
+            auto id = p.expect_integer();
+            auto offset = p.expect_integer();
+            if (id < 0 || id > std::numeric_limits<unsigned>::max() || offset < 0
+                || static_cast<unsigned long long>(offset) > data.size() - first)
+                throw format_error("object_stream: invalid object offset");
+            index.emplace_back(static_cast<unsigned>(id), static_cast<unsigned>(first + offset), data.size());
+        }
+
+        // each object ends where the next one (by offset) begins
+        std::vector<unsigned> starts;
+        for (const auto& e : index)
+            starts.push_back(e.begin);
+        std::sort(starts.begin(), starts.end());
+        for (auto& e : index) {
+            auto next = std::upper_bound(starts.begin(), starts.end(), e.begin);
+            if (next != starts.end())
+                e.end = *next;
+        }
+    }
+
+    auto object_stream::id(unsigned i) const -> unsigned {
+        if (i >= index.size())
+            throw format_error("object_stream::id: invalid index");
+        return index[i].id;
+    }
+
+    auto object_stream::get(unsigned i) const -> variant {
+        if (i >= index.size())
+            throw format_error("object_stream::get: invalid index");
+        if (index[i].begin == index[i].end)
+            throw format_error("object_stream::get: empty object");
+        tools::atom_table tab;
+        parser p(slice(data.data() + index[i].begin, data.data() + index[i].end), tab);
+        return p.expect_object();
+    }
+
+}
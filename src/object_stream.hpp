@@ -0,0 +1,46 @@
+#ifndef OBJECT_STREAM_HPP
+#define OBJECT_STREAM_HPP
+
+#include <vector>
+
+#include "tools.hpp"
+#include "parser.hpp"
+
+namespace pdf {
+
+    using tools::slice;
+    using tools::variant;
+
+    /*
+        An object stream (/Type /ObjStm) holds a sequence of non-stream objects.
+        The stream is decoded once, when the object_stream is constructed, and the
+        N pairs of object numbers and offsets at its start are parsed into an index.
+        Individual objects are only parsed when they are asked for.
+        Objects returned by get() refer to the decoded data, so they must not
+        outlive the object_stream.
+    */
+    class object_stream {
+    public:
+        object_stream(const indirect_object& stream);
+
+        object_stream(const object_stream&) = delete;
+        auto operator=(const object_stream&) -> object_stream& = delete;
+
+        auto size() const noexcept -> unsigned { return index.size(); }
+        auto id(unsigned i) const -> unsigned;
+        auto get(unsigned i) const -> variant;
+
+    private:
+        struct entry {
+            entry(unsigned id, unsigned begin, unsigned end) : id(id), begin(begin), end(end) {}
+            unsigned id;
+            unsigned begin, end; // location of the object within the decoded data
+        };
+
+        std::vector<char> data;
+        std::vector<entry> index;
+    };
+
+}
+
+#endif
@@ -0,0 +1,27 @@
+#include "parallel_decode.hpp"
+#include "filters.hpp"
+
+namespace pdf {
+
+    auto decode_streams(const std::vector<indirect_object>& objects, tools::task_scheduler& scheduler) -> decoded_streams {
+        decoded_streams result;
+        result.data.resize(objects.size(), slice(""));
+        result.errors.resize(objects.size());
+        for (unsigned i = 0; i < scheduler.size(); ++i)
+            result.arenas.emplace_back(new tools::arena());
+
+        // each task writes only its own entries, and its worker's arena
+        scheduler.for_each(objects.size(), [&](std::size_t i, unsigned worker) {
+            auto& object = objects[i];
+            if (!object.stream)
+                return;
+            try {
+                result.data[i] = decode_stream(object.object, *object.stream, *result.arenas[worker]);
+            } catch (...) {
+                result.errors[i] = std::current_exception();
+            }
+        });
+        return result;
+    }
+
+}
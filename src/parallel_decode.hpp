@@ -0,0 +1,31 @@
+#ifndef PARALLEL_DECODE_HPP
+#define PARALLEL_DECODE_HPP
+
+#include <exception>
+#include <memory>
+#include <vector>
+
+#include "parser.hpp"
+#include "tools.hpp"
+#include "tools/arena.hpp"
+#include "tools/task_scheduler.hpp"
+
+namespace pdf {
+
+    struct decoded_streams {
+        std::vector<slice> data; // the decoded data of each object, empty if it has no stream
+        std::vector<std::exception_ptr> errors; // why each object failed to decode, if it did
+        std::vector<std::unique_ptr<tools::arena>> arenas; // one per worker, holding data
+    };
+
+    /*
+        Decode the streams of objects concurrently, each worker into an arena of its own,
+        so they don't contend for memory. A stream which fails to decode doesn't stop the
+        others: its error is kept in place of its data. The data of the objects must
+        stay valid until this returns.
+    */
+    auto decode_streams(const std::vector<indirect_object>& objects, tools::task_scheduler& scheduler) -> decoded_streams;
+
+}
+
+#endif
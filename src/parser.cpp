@@ -1,5 +1,8 @@
 #include "pdfp.hpp"
 
+#include <climits>
+#include <cstring>
+
 #include "parser.hpp"
 #include "tools.hpp"
 
@@ -91,14 +94,9 @@ namespace {
             return token(token_type::bad_token, input);
         if (input[1] == '<')
             return token(token_type::dict_begin, input.left(2));
-        bool done = false;
-        auto tok = input.take_until([&](char ch)->bool {
-            if (done)
-                return true;
-            done = ch == '>';
-            return false;
-        });
-        return token(token_type::hexstring, tok);
+        // the digits are only checked when the string is decoded, by decode_hexstring
+        auto end = static_cast<const char*>(std::memchr(input.begin() + 1, '>', input.length() - 1));
+        return token(token_type::hexstring, slice(input.begin(), end ? end + 1 : input.end()));
     }
 
     auto rbrack(slice input) noexcept -> token {
@@ -220,6 +218,10 @@ namespace {
 
     }
 
+    auto fits_int(long long value) noexcept -> bool {
+        return value >= INT_MIN && value <= INT_MAX;
+    }
+
     /*
         Replace the id and gen objects at the end of objects vector with a reference object.
     */
@@ -233,6 +235,8 @@ namespace {
         auto id = objects.back();
         if (!id.is_integer())
             throw format_error("generate_reference: id is not an integer");
+        if (!fits_int(id.get_integer()) || !fits_int(gen.get_integer()))
+            throw format_error("generate_reference: invalid object number");
         objects.pop_back();
         objects.push_back(variant::make_ref(id.get_integer(), gen.get_integer()));
     }
@@ -279,7 +283,7 @@ namespace pdf {
             throw format_error("parser::expect_keyword: unexpected keyword");
     }
 
-    auto parser::expect_integer() -> int {
+    auto parser::expect_integer() -> long long {
         auto i = next_object();
         if (!i)
             throw format_error("parser::expect_keyword: unexpected end");
@@ -297,6 +301,114 @@ namespace pdf {
         return *dict;
     }
 
+    /*
+        Parses an indirect object definition ("N G obj object endobj").
+        If the object is a stream, the stream data is returned as a slice of the input.
+    */
+    auto parser::expect_indirect_object(const length_resolver& resolve) -> indirect_object {
+        auto id = expect_integer();
+        auto gen = expect_integer();
+        if (id < 0 || id > INT_MAX || gen < 0 || gen > INT_MAX)
+            throw format_error("parser::expect_indirect_object: invalid object number");
+        expect_keyword(keywords::obj);
+
+        std::vector<variant> body;
+        auto terminator = parse_body(body);
+        if (terminator == 0)
+            throw format_error("parser::expect_indirect_object: unexpected end");
+        if (body.size() > 1)
+            throw format_error("parser::expect_indirect_object: too many objects");
+        auto object = body.empty() ? variant::make_null() : body.front();
+        if (terminator == keywords::endobj)
+            return indirect_object(objref(id, gen), object);
+
+        if (!object.is_dict())
+            throw format_error("parser::expect_indirect_object: stream without a dictionary");
+        auto stream = parse_stream(object, resolve);
+        expect_keyword(keywords::endobj);
+        return indirect_object(objref(id, gen), object, std::experimental::make_optional(stream));
+    }
+
+    /*
+        Parses the entire input as a single object, which may be an indirect reference.
+        Used for objects in object streams, which have no obj/endobj keywords.
+    */
+    auto parser::expect_object() -> variant {
+        std::vector<variant> body;
+        if (parse_body(body) != 0 || body.size() != 1)
+            throw format_error("parser::expect_object: expected one object");
+        return body.front();
+    }
+
+    /*
+        Parses objects up to an endobj or stream keyword (which is returned)
+        or the end of input (where 0 is returned).
+    */
+    auto parser::parse_body(std::vector<variant>& body) -> atom_type {
+        for (;;) {
+            auto tok = peek_token(this->input);
+            if (!tok)
+                return 0;
+            auto kw = tok->type() == token_type::keyword ? atoms[tok->value()] : 0;
+            switch (kw) {
+                case keywords::endobj:
+                case keywords::stream:
+                    skip_token(*tok);
+                    return kw;
+                case keywords::R:
+                    generate_reference(body);
+                    skip_token(*tok);
+                    break;
+                default:
+                    body.push_back(*next_object());
+                    break;
+            }
+        }
+    }
+
+    /*
+        Extracts the stream data following the stream keyword.
+        /Length (resolved through resolve if it is indirect) lets us jump straight
+        over the data. We only scan for endstream when /Length is missing or wrong.
+    */
+    auto parser::parse_stream(const variant& dict, const length_resolver& resolve) -> slice {
+        // stream should be followed by CRLF or LF, but a lone CR is tolerated
+        slice data = this->input.starts_with("\r\n") ? this->input.skip(2)
+            : !this->input.empty() && iseol(*this->input) ? this->input.rest()
+            : this->input;
+
+        long long length = -1;
+        const auto& d = dict.get_dict();
+        auto len = d.find(names::Length);
+        if (len != d.end()) {
+            if (len->second.is_integer())
+                length = len->second.get_integer();
+            else if (len->second.is_ref() && resolve)
+                length = resolve(len->second.get_ref());
+        }
+        if (length >= 0 && static_cast<unsigned long long>(length) <= data.length()) {
+            auto rest = skipws(data.skip(length));
+            if (rest.starts_with("endstream")) {
+                this->input = rest;
+                expect_keyword(keywords::endstream);
+                return data.left(static_cast<std::size_t>(length));
+            }
+        }
+
+        auto end = data.find_first("endstream");
+        if (end.empty())
+            throw format_error("parser::parse_stream: missing endstream");
+        this->input = end;
+        expect_keyword(keywords::endstream);
+        // the end of line marker preceding endstream is not part of the data
+        auto p = end.begin();
+        if (p > data.begin() && p[-1] == '\n')
+            --p;
+        if (p > data.begin() && p[-1] == '\r')
+            --p;
+        return slice(data.begin(), p);
+    }
+
     void parser::parse_until(token_type type, std::vector<variant>& result) {
         for (;;) {
             auto tok = peek_token(this->input);
@@ -2,6 +2,8 @@
 #define PARSER_HPP
 
 #include <experimental/optional>
+#include <functional>
+#include <memory>
 #include <ostream>
 #include <tuple>
 #include <vector>
@@ -14,6 +16,7 @@ namespace pdf {
     using tools::variant;
     using tools::atom_table;
     using tools::atom_type;
+    using tools::objref;
 
     enum class token_type {
         bad_token,
@@ -41,6 +44,29 @@ namespace pdf {
     auto next_token(slice input) noexcept -> std::tuple<opt_token, slice>;
 
     using opt_variant = std::experimental::optional<variant>;
+    using opt_slice = std::experimental::optional<slice>;
+
+    /*
+        An indirect object is a numbered object definition ("N G obj ... endobj").
+        If the object is a stream, stream refers to the raw (undecoded) stream
+        data in the original input: nothing is copied. When the input was read
+        into a buffer, storage keeps that buffer alive.
+    */
+    struct indirect_object {
+        indirect_object(objref ref, const variant& object, opt_slice stream = opt_slice())
+            : ref(ref), object(object), stream(stream) {}
+
+        objref ref;
+        variant object;
+        opt_slice stream;
+        std::shared_ptr<const void> storage;
+    };
+
+    /*
+        Returns the value of an indirect stream /Length. It is only called
+        when a stream actually has an indirect /Length.
+    */
+    using length_resolver = std::function<auto (objref)->long long>;
 
     class parser {
     public:
@@ -48,8 +74,10 @@ namespace pdf {
 
         auto next_object() -> opt_variant;
         void expect_keyword(atom_type keyword);
-        auto expect_integer() -> int;
+        auto expect_integer() -> long long;
         auto expect_dict() -> variant;
+        auto expect_indirect_object(const length_resolver& resolve = nullptr) -> indirect_object;
+        auto expect_object() -> variant;
         auto remainder() const noexcept -> slice { return input; }
 
     private:
@@ -63,6 +91,8 @@ namespace pdf {
         void parse_until(token_type type, std::vector<variant>& result);
         auto parse_array() -> variant;
         auto parse_dict() -> variant;
+        auto parse_body(std::vector<variant>& body) -> atom_type;
+        auto parse_stream(const variant& dict, const length_resolver& resolve) -> slice;
     };
 
 }
@@ -13,22 +13,55 @@ namespace pdf {
     const std::unordered_map<slice, atom_type, tools::atom_table::hash> tools::atom_table::pdf_table {
 
         // keywords
+        { "endobj", keywords::endobj },
+        { "endstream", keywords::endstream },
         { "f", keywords::f },
         { "false", keywords::_false },
         { "n", keywords::n },
         { "null", keywords::null },
+        { "obj", keywords::obj },
         { "R", keywords::R },
+        { "stream", keywords::stream },
         { "trailer", keywords::trailer },
         { "true", keywords::_true },
         { "startxref", keywords::startxref },
         { "xref", keywords::xref },
 
         // names
+        { "/ASCII85Decode", names::ASCII85Decode },
+        { "/ASCIIHexDecode", names::ASCIIHexDecode },
+        { "/BitsPerComponent", names::BitsPerComponent },
+        { "/Catalog", names::Catalog },
+        { "/Colors", names::Colors },
+        { "/Columns", names::Columns },
+        { "/DecodeParms", names::DecodeParms },
+        { "/DL", names::DL },
+        { "/E", names::E },
+        { "/EarlyChange", names::EarlyChange },
+        { "/Filter", names::Filter },
+        { "/First", names::First },
+        { "/FlateDecode", names::FlateDecode },
+        { "/H", names::H },
         { "/ID", names::ID },
+        { "/Index", names::Index },
         { "/Info", names::Info },
+        { "/L", names::L },
+        { "/Length", names::Length },
+        { "/Linearized", names::Linearized },
+        { "/LZWDecode", names::LZWDecode },
+        { "/N", names::N },
+        { "/O", names::O },
+        { "/ObjStm", names::ObjStm },
+        { "/Predictor", names::Predictor },
         { "/Prev", names::Prev },
         { "/Root", names::Root },
+        { "/S", names::S },
         { "/Size", names::Size },
+        { "/T", names::T },
+        { "/Type", names::Type },
+        { "/W", names::W },
+        { "/XRef", names::XRef },
+        { "/XRefStm", names::XRefStm },
 
     };
 
@@ -1,6 +1,8 @@
 #ifndef PDF_DICTIONARIES_HPP
 #define PDF_DICTIONARIES_HPP
 
+#include <vector>
+
 #include "tools.hpp"
 
 namespace pdf {
@@ -12,11 +14,29 @@ namespace pdf {
     public:
         pdf_dict(const variant& v) : dict(v.get_dict()) {}
 
-        auto get_integer(atom_type name, int value = 0) const -> int {
+        auto has(atom_type name) const -> bool {
+            return dict.find(name) != dict.end();
+        }
+
+        auto get_integer(atom_type name, long long value = 0) const -> long long {
             auto val = dict.find(name);
             return val == dict.end() ? value : val->second.get_integer();
         }
 
+        auto get_name(atom_type name, atom_type value = 0) const -> atom_type {
+            auto val = dict.find(name);
+            return val == dict.end() ? value : val->second.get_name();
+        }
+
+        auto get_integers(atom_type name) const -> std::vector<long long> {
+            std::vector<long long> result;
+            auto val = dict.find(name);
+            if (val != dict.end())
+                for (const auto& i : val->second.get_array())
+                    result.push_back(i.get_integer());
+            return result;
+        }
+
     private:
         const variant::dict_type& dict;
     };
@@ -25,8 +45,46 @@ namespace pdf {
     public:
         trailer_dict(const variant& v) : pdf_dict(v) {}
 
-        auto Size() const -> int { return get_integer(names::Size); }
-        auto Prev() const -> int { return get_integer(names::Prev); }
+        auto Size() const -> long long { return get_integer(names::Size); }
+        auto Prev() const -> long long { return get_integer(names::Prev); }
+        auto XRefStm() const -> long long { return get_integer(names::XRefStm); }
+    };
+
+    class xref_stream_dict : public trailer_dict {
+    public:
+        xref_stream_dict(const variant& v) : trailer_dict(v) {}
+
+        auto Type() const -> atom_type { return get_name(names::Type); }
+        auto W() const -> std::vector<long long> { return get_integers(names::W); }
+        auto Index() const -> std::vector<long long> {
+            return has(names::Index) ? get_integers(names::Index) : std::vector<long long>{ 0, Size() };
+        }
+    };
+
+    /*
+        The linearization parameter dictionary, the first object in a linearized file.
+    */
+    class linearization_dict : public pdf_dict {
+    public:
+        linearization_dict(const variant& v) : pdf_dict(v) {}
+
+        auto L() const -> long long { return get_integer(names::L); } // the length of the file
+        auto H() const -> std::vector<long long> { return get_integers(names::H); } // the primary hint stream
+        auto O() const -> long long { return get_integer(names::O); } // the first page's page object
+        auto E() const -> long long { return get_integer(names::E); } // the end of the first page
+        auto N() const -> long long { return get_integer(names::N); } // the number of pages
+        auto T() const -> long long { return get_integer(names::T); } // the main xref table's first entry
+    };
+
+    class decode_parms_dict : public pdf_dict {
+    public:
+        decode_parms_dict(const variant& v) : pdf_dict(v) {}
+
+        auto Predictor() const -> long long { return get_integer(names::Predictor, 1); }
+        auto Colors() const -> long long { return get_integer(names::Colors, 1); }
+        auto BitsPerComponent() const -> long long { return get_integer(names::BitsPerComponent, 8); }
+        auto Columns() const -> long long { return get_integer(names::Columns, 1); }
+        auto EarlyChange() const -> long long { return get_integer(names::EarlyChange, 1); }
     };
 }
 
@@ -2,9 +2,13 @@
 
 #include "pdfp.hpp"
 
+#include "byte_source.hpp"
+#include "object_loader.hpp"
 #include "parser.hpp"
 #include "pdf_dictionaries.hpp"
+#include "pipe_source.hpp"
 #include "tools.hpp"
+#include "xref_cache.hpp"
 #include "xref_table.hpp"
 
 namespace pdf {
@@ -16,40 +20,76 @@ namespace pdf {
 
     class pdf_parser : public PdfParser {
     public:
-        pdf_parser(slice pdf) : pdf(pdf) { init(); }
+        pdf_parser(unique_ptr<byte_source> source, const scan_result* scanned = nullptr)
+            : source(std::move(source)), scanned(scanned) {
+            init();
+        }
+        pdf_parser(unique_ptr<byte_source> source, const std::string& filename, const std::string& xref_cache)
+            : source(std::move(source)) {
+            init(filename, xref_cache);
+        }
         ~pdf_parser() {}
 
     private:
-        slice pdf;
+        unique_ptr<byte_source> source;
+        const scan_result* scanned = nullptr; // the objects in source, if they are already known
         atom_table atoms;
         unique_ptr<xref_table> xref;
+        unique_ptr<object_loader> objects;
 
         void init() {
-            if (!pdf.starts_with("%PDF-1."))
+            check_header();
+            load_xref();
+            objects = make_unique<object_loader>(*source, *xref);
+        }
+
+        void init(const std::string& filename, const std::string& xref_cache) {
+            check_header();
+            auto key = make_xref_cache_key(filename, *source);
+            xref = make_unique<xref_table>(*source);
+            if (!load_xref_cache(xref_cache, key, *xref)) {
+                load_xref();
+                try {
+                    save_xref_cache(xref_cache, key, *xref);
+                } catch (pdf_error&) {
+                    // the cache is only an optimization
+                }
+            }
+            objects = make_unique<object_loader>(*source, *xref);
+        }
+
+        void check_header() {
+            if (!source->read(0, 7).data.starts_with("%PDF-1."))
                 throw pdf_error("no pdf header");
-            slice trailer = pdf.find_last("trailer");
-            if (trailer.empty())
-                throw pdf_error("no pdf trailer");
-            process_trailer(trailer);
         }
 
-        void process_trailer(slice input) {
-            parser p(input, atoms);
-            p.expect_keyword(keywords::trailer);
-            auto dict = p.expect_dict();
-            trailer_dict trailer(dict);
-            xref = make_unique<xref_table>(pdf, trailer.Size());
-
-            int prev = trailer.Prev();
-            if (prev != 0)
-                xref->get_previous(prev);
-            p.expect_keyword(keywords::startxref);
-            xref->get_from(p.expect_integer());
+        void load_xref() {
+            xref = make_unique<xref_table>(*source);
+            xref->load(scanned);
         }
     };
 
     auto make_pdf_parser(const char* begin, const char* end) -> unique_ptr<PdfParser> {
-        return make_unique<pdf_parser>(slice(begin, end));
+        return make_unique<pdf_parser>(make_unique<memory_source>(slice(begin, end)));
+    }
+
+    auto make_pdf_parser(const char* begin, const char* end, const std::string& filename,
+                         const std::string& xref_cache) -> unique_ptr<PdfParser> {
+        return make_unique<pdf_parser>(make_unique<memory_source>(slice(begin, end)), filename, xref_cache);
+    }
+
+    auto make_pdf_parser(unique_ptr<byte_source> source) -> unique_ptr<PdfParser> {
+        return make_unique<pdf_parser>(std::move(source));
+    }
+
+    auto make_pdf_parser(unique_ptr<byte_source> source, const std::string& filename,
+                         const std::string& xref_cache) -> unique_ptr<PdfParser> {
+        return make_unique<pdf_parser>(std::move(source), filename, xref_cache);
+    }
+
+    auto make_pdf_parser(unique_ptr<pipe_source> source) -> unique_ptr<PdfParser> {
+        const auto& scanned = source->objects();
+        return make_unique<pdf_parser>(std::move(source), &scanned);
     }
 
-}
\ No newline at end of file
+}
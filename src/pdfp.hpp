@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <stdexcept>
+#include <string>
 
 namespace pdf {
 
@@ -22,6 +23,33 @@ namespace pdf {
 
     auto make_pdf_parser(const char* begin, const char* end) -> std::unique_ptr<PdfParser>;
 
+    /*
+        As above, for the contents of filename. The resolved xref table is kept in the
+        sidecar file xref_cache, which is used instead of parsing the xref sections
+        as long as filename hasn't changed.
+    */
+    auto make_pdf_parser(const char* begin, const char* end, const std::string& filename,
+                         const std::string& xref_cache) -> std::unique_ptr<PdfParser>;
+
+    class byte_source;
+
+    /*
+        As above, but the pdf is read from source as it is needed (see byte_source.hpp),
+        so it doesn't need to be in memory.
+    */
+    auto make_pdf_parser(std::unique_ptr<byte_source> source) -> std::unique_ptr<PdfParser>;
+    auto make_pdf_parser(std::unique_ptr<byte_source> source, const std::string& filename,
+                         const std::string& xref_cache) -> std::unique_ptr<PdfParser>;
+
+    class pipe_source;
+
+    /*
+        As above, for a pdf which was read from a pipe (see pipe_source.hpp). If the
+        file is damaged, its xref table is rebuilt from the objects found while it
+        was being read.
+    */
+    auto make_pdf_parser(std::unique_ptr<pipe_source> source) -> std::unique_ptr<PdfParser>;
+
 }
 
 #endif
\ No newline at end of file
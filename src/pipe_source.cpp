@@ -0,0 +1,110 @@
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include "pipe_source.hpp"
+#include "pdfp.hpp"
+
+namespace {
+
+    // the amount read from the pipe at a time
+    const std::size_t part_size = 1 << 16;
+
+    auto read_part(int fd, std::vector<char>& part) -> std::size_t {
+        for (;;) {
+            auto r = ::read(fd, part.data(), part.size());
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r < 0)
+                throw pdf::pdf_error("pipe_source: read failed");
+            return static_cast<std::size_t>(r);
+        }
+    }
+
+    void write_all(int fd, const char* data, std::size_t length) {
+        while (length > 0) {
+            auto r = ::write(fd, data, length);
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r <= 0)
+                throw pdf::pdf_error("pipe_source: can't write spill file");
+            data += r;
+            length -= r;
+        }
+    }
+
+    /*
+        A temporary file, which is removed when it goes out of scope. It can be
+        mapped (by name) once it has been written.
+    */
+    class spill_file {
+    public:
+        spill_file() {
+            auto dir = std::getenv("TMPDIR");
+            name = std::string(dir != nullptr && *dir != 0 ? dir : P_tmpdir) + "/pdfp_spill_XXXXXX";
+            fd = mkstemp(&name[0]);
+            if (fd < 0)
+                throw pdf::pdf_error("pipe_source: can't create spill file");
+        }
+
+        ~spill_file() {
+            close();
+            unlink(name.c_str());
+        }
+
+        void write(const char* data, std::size_t length) { write_all(fd, data, length); }
+
+        void close() {
+            if (fd >= 0)
+                ::close(fd);
+            fd = -1;
+        }
+
+        std::string name;
+
+    private:
+        int fd;
+    };
+
+}
+
+namespace pdf {
+
+    pipe_source::pipe_source(int fd, std::size_t memory_limit) : input("") {
+        std::unique_ptr<spill_file> spill;
+        std::vector<char> part(part_size);
+        while (auto length = read_part(fd, part)) {
+            scanner.scan(slice(part.data(), length));
+            if (!spill && buffer.size() + length > memory_limit) {
+                spill = std::make_unique<spill_file>();
+                spill->write(buffer.data(), buffer.size());
+                std::vector<char>().swap(buffer);
+            }
+            if (spill)
+                spill->write(part.data(), length);
+            else
+                buffer.insert(buffer.end(), part.begin(), part.begin() + length);
+        }
+        scanner.finish();
+
+        if (spill) {
+            spill->close();
+            // the mapping stays valid after the file is removed
+            file = mapped_file(spill->name, access_pattern::random);
+            input = file.data();
+        } else if (!buffer.empty()) {
+            input = slice(buffer.data(), buffer.size());
+        }
+    }
+
+    auto pipe_source::read(std::uint64_t offset, std::size_t length) const -> byte_range {
+        if (offset >= input.length())
+            return byte_range(slice(input.end(), input.end()));
+        return byte_range(input.skip(static_cast<std::size_t>(offset)).left(length));
+    }
+
+}
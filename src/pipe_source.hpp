@@ -0,0 +1,47 @@
+#ifndef PIPE_SOURCE_HPP
+#define PIPE_SOURCE_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "byte_source.hpp"
+#include "mapped_file.hpp"
+#include "xref_scanner.hpp"
+
+namespace pdf {
+
+    /*
+        A pdf read from a file descriptor which can't seek, such as a pipe from another
+        program. The constructor reads it until EOF, keeping it in memory up to
+        memory_limit bytes, beyond which it is spilled to a temporary file (in $TMPDIR)
+        which is then mapped. The file is scanned for objects as it arrives, so that
+        if it turns out to be damaged, its xref table can be rebuilt without scanning
+        it again.
+    */
+    class pipe_source : public byte_source {
+    public:
+        explicit pipe_source(int fd, std::size_t memory_limit = 1 << 26);
+
+        pipe_source(const pipe_source&) = delete;
+        pipe_source& operator=(const pipe_source&) = delete;
+
+        auto size() const noexcept -> std::uint64_t override { return input.length(); }
+        auto read(std::uint64_t offset, std::size_t length) const -> byte_range override;
+        auto in_memory() const noexcept -> bool override { return true; }
+
+        // true if the input didn't fit in memory_limit
+        auto spilled() const noexcept -> bool { return file.size() != 0; }
+
+        // the objects and trailers found in the input
+        auto objects() const noexcept -> const scan_result& { return scanner.result(); }
+
+    private:
+        std::vector<char> buffer; // the input, unless it was spilled
+        mapped_file file; // the input, if it was spilled
+        slice input;
+        object_scanner scanner;
+    };
+
+}
+
+#endif
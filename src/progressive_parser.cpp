@@ -0,0 +1,143 @@
+#include "progressive_parser.hpp"
+
+#include "parser.hpp"
+#include "pdf_dictionaries.hpp"
+
+namespace {
+
+    // the linearization dictionary is entirely contained in the first 1024 bytes of the file
+    const std::size_t linearization_window = 1024;
+
+}
+
+namespace pdf {
+
+    auto progressive_parser::first_page_ready() -> bool {
+        update();
+        return loader != nullptr;
+    }
+
+    auto progressive_parser::ready() -> bool {
+        update();
+        return current == stage::done;
+    }
+
+    auto progressive_parser::first_page() const -> objref {
+        if (!linearized())
+            return objref();
+        return objref(static_cast<int>(linearization_dict(params).O()), 0);
+    }
+
+    auto progressive_parser::xref() const -> const xref_table& {
+        if (!table)
+            throw pdf_error("progressive_parser::xref: not ready");
+        return *table;
+    }
+
+    auto progressive_parser::objects() const -> object_loader& {
+        if (!loader)
+            throw pdf_error("progressive_parser::objects: not ready");
+        return *loader;
+    }
+
+    /*
+        The primary hint stream is usually in the first page section, but may also be
+        at the end of the file.
+    */
+    auto progressive_parser::hints() -> const hint_tables& {
+        if (hint_table)
+            return *hint_table;
+        if (!linearized())
+            throw pdf_error("progressive_parser::hints: not a linearized file");
+        auto h = linearization_dict(params).H();
+        if (h.size() < 2 || h[0] <= 0)
+            throw format_error("progressive_parser::hints: invalid hint stream offset");
+        read_window(source, static_cast<std::uint64_t>(h[0]), [&](const byte_range& window) {
+            tools::atom_table tab;
+            parser p(window.data, tab);
+            auto stream = p.expect_indirect_object([this](objref ref) -> long long {
+                if (!loader)
+                    return -1;
+                auto length = loader->get(ref).object;
+                return length.is_integer() ? length.get_integer() : -1;
+            });
+            hint_table = std::make_unique<hint_tables>(stream, params);
+            return !p.remainder().empty();
+        });
+        return *hint_table;
+    }
+
+    void progressive_parser::prefetch_page(unsigned n) {
+        source.prefetch(hints().page_extents(n));
+    }
+
+    void progressive_parser::update() {
+        if (current == stage::header && read_linearization())
+            current = linearized() ? stage::first_page : stage::rest;
+        if (current == stage::first_page && read_first_page())
+            current = stage::rest;
+        if (current == stage::rest && source.complete()) {
+            // startxref leads to the first page's section, whose /Prev is the main section
+            auto rest = std::make_unique<xref_table>(source);
+            rest->load();
+            loader = std::make_unique<object_loader>(source, *rest);
+            table = std::move(rest);
+            current = stage::done;
+        }
+    }
+
+    /*
+        Returns false while it is too early to tell whether the file is linearized.
+    */
+    auto progressive_parser::read_linearization() -> bool {
+        auto window = source.read(0, linearization_window);
+        bool whole = window.data.length() == linearization_window || source.complete();
+        if (!window.data.starts_with("%PDF-1.")) {
+            if (window.data.length() >= 7 || source.complete())
+                throw pdf_error("no pdf header");
+            return false;
+        }
+        try {
+            tools::atom_table tab;
+            parser p(window.data, tab);
+            auto object = p.expect_indirect_object();
+            if (!object.object.is_dict() || !object.object.haskey(names::Linearized))
+                return true;
+            // a linearized file which has since been updated is no longer linearized
+            linearization_dict dict(object.object);
+            auto length = static_cast<std::uint64_t>(dict.L());
+            if (dict.L() <= 0 || dict.O() <= 0 || dict.E() <= 0 || source.size() > length
+                || (source.complete() && source.size() != length))
+                return true;
+            params = object.object;
+            params_storage = window.storage;
+            first_xref = p.remainder().begin() - window.data.begin();
+            return true;
+        } catch (std::runtime_error&) {
+            // the first object may not have arrived yet
+            return whole;
+        }
+    }
+
+    /*
+        Returns true once the file has arrived up to the end of the first page, and its
+        xref section has been read. The section's /Prev isn't followed yet.
+    */
+    auto progressive_parser::read_first_page() -> bool {
+        if (source.size() < static_cast<std::uint64_t>(linearization_dict(params).E()) && !source.complete())
+            return false;
+        try {
+            auto first = std::make_unique<xref_table>(source);
+            first->get_from(static_cast<long long>(first_xref), false);
+            loader = std::make_unique<object_loader>(source, *first);
+            table = std::move(first);
+            return true;
+        } catch (std::runtime_error&) {
+            // the first page section is damaged: wait for the whole file
+            params = variant::make_null();
+            params_storage = nullptr;
+            return true;
+        }
+    }
+
+}
@@ -0,0 +1,86 @@
+#ifndef PROGRESSIVE_PARSER_HPP
+#define PROGRESSIVE_PARSER_HPP
+
+#include <cstdint>
+#include <memory>
+
+#include "byte_source.hpp"
+#include "hint_tables.hpp"
+#include "object_loader.hpp"
+#include "tools.hpp"
+#include "xref_table.hpp"
+
+namespace pdf {
+
+    using tools::objref;
+    using tools::variant;
+
+    /*
+        Opens a pdf which is still arriving (see growing_source). A linearized file starts
+        with a linearization dictionary, followed by an xref section for the objects of the
+        first page, which come next. So the first page (and the catalog) can be loaded as
+        soon as the file has arrived up to the end of the first page, long before the main
+        xref section at the end of the file.
+
+        Each call to first_page_ready or ready makes what progress it can with the part of
+        the file which has arrived. The rest of the table is loaded once the source is
+        complete, which is also the earliest the table of a file which isn't linearized
+        can be loaded.
+    */
+    class progressive_parser {
+    public:
+        explicit progressive_parser(const byte_source& source) : source(source) {}
+
+        progressive_parser(const progressive_parser&) = delete;
+        progressive_parser& operator=(const progressive_parser&) = delete;
+
+        // true once the objects of the first page can be loaded
+        auto first_page_ready() -> bool;
+
+        // true once every object can be loaded
+        auto ready() -> bool;
+
+        // the linearization dictionary, or null if the file isn't (or isn't yet known to be) linearized
+        auto linearization() const noexcept -> const variant& { return params; }
+        auto linearized() const noexcept -> bool { return params.is_dict(); }
+
+        // the first page's page object, if the file is linearized
+        auto first_page() const -> objref;
+
+        // available once first_page_ready
+        auto xref() const -> const xref_table&;
+
+        // available once first_page_ready, and replaced once ready
+        auto objects() const -> object_loader&;
+
+        // the hint tables of a linearized file, available once its hint stream has arrived
+        auto hints() -> const hint_tables&;
+
+        // start reading page n (counting from 0) and the shared objects it uses, using the hint tables
+        void prefetch_page(unsigned n);
+
+    private:
+        enum class stage {
+            header,     // waiting for the linearization dictionary
+            first_page, // waiting for the first page
+            rest,       // waiting for the rest of the file
+            done
+        };
+
+        const byte_source& source;
+        stage current = stage::header;
+        variant params;
+        std::shared_ptr<const void> params_storage; // keeps the strings in params valid
+        std::uint64_t first_xref = 0; // the offset of the first page's xref section
+        std::unique_ptr<xref_table> table;
+        std::unique_ptr<object_loader> loader;
+        std::unique_ptr<hint_tables> hint_table;
+
+        void update();
+        auto read_linearization() -> bool;
+        auto read_first_page() -> bool;
+    };
+
+}
+
+#endif
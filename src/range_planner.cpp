@@ -0,0 +1,63 @@
+#include <algorithm>
+
+#include "range_planner.hpp"
+#include "pdf_dictionaries.hpp"
+
+namespace pdf {
+
+    range_planner::range_planner(const xref_table& xref, std::uint64_t file_size, std::uint64_t max_gap)
+        : xref(xref), file_size(file_size), max_gap(max_gap) {
+        for (unsigned id = 0; id < xref.size(); ++id)
+            if (xref[id].type() == xref_type::in_use)
+                offsets.push_back(xref[id].offset());
+        if (xref.trailer_offset() != 0)
+            offsets.push_back(xref.trailer_offset());
+        std::sort(offsets.begin(), offsets.end());
+    }
+
+    /*
+        Free and missing objects, and those beyond the end of the file, take up no space.
+    */
+    auto range_planner::extent(objref ref) const -> byte_extent {
+        auto entry = xref[ref.id];
+        if (entry.type() == xref_type::compressed)
+            entry = xref[entry.stream()];
+        if (entry.type() != xref_type::in_use || entry.offset() >= file_size)
+            return byte_extent(0, 0);
+        auto next = std::upper_bound(offsets.begin(), offsets.end(), entry.offset());
+        auto end = next == offsets.end() ? file_size : std::min(*next, file_size);
+        return byte_extent(entry.offset(), static_cast<std::size_t>(end - entry.offset()));
+    }
+
+    auto range_planner::objects(const std::vector<objref>& refs) const -> std::vector<byte_extent> {
+        std::vector<byte_extent> extents;
+        for (auto ref : refs)
+            extents.push_back(extent(ref));
+        return coalesce(extents, max_gap);
+    }
+
+    /*
+        The catalog's /Metadata stream can only be found once the catalog has been read,
+        so it takes another plan.
+    */
+    auto range_planner::metadata() const -> std::vector<byte_extent> {
+        std::vector<objref> refs;
+        const auto& trailer = xref.trailer();
+        for (auto name : { names::Root, names::Info })
+            if (trailer.is_dict() && trailer.haskey(name) && trailer[name].is_ref())
+                refs.push_back(trailer[name].get_ref());
+        return objects(refs);
+    }
+
+    auto range_planner::page(const hint_tables& hints, unsigned n) const -> std::vector<byte_extent> {
+        return coalesce(hints.page_extents(n), max_gap);
+    }
+
+    auto total_length(const std::vector<byte_extent>& extents) noexcept -> std::uint64_t {
+        std::uint64_t total = 0;
+        for (const auto& extent : extents)
+            total += extent.length;
+        return total;
+    }
+
+}
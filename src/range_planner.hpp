@@ -0,0 +1,53 @@
+#ifndef RANGE_PLANNER_HPP
+#define RANGE_PLANNER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "byte_source.hpp"
+#include "hint_tables.hpp"
+#include "tools.hpp"
+#include "xref_table.hpp"
+
+namespace pdf {
+
+    using tools::objref;
+
+    /*
+        Works out which parts of a pdf to fetch for a given purpose, for files in remote
+        storage, where every round trip counts. Nothing is read: the plans are made from
+        the xref table, and for pages, the hint tables of a linearized file. Ranges no
+        more than max_gap bytes apart are coalesced, trading bytes for round trips.
+
+        Objects are assumed to extend up to the next object (or xref section) in the
+        file, which is also where object_loader expects them to end.
+    */
+    class range_planner {
+    public:
+        range_planner(const xref_table& xref, std::uint64_t file_size, std::uint64_t max_gap = 1 << 12);
+
+        // the ranges holding these objects, or the object streams they are stored in
+        auto objects(const std::vector<objref>& refs) const -> std::vector<byte_extent>;
+
+        // the ranges holding the document catalog and information dictionary
+        auto metadata() const -> std::vector<byte_extent>;
+
+        // the ranges holding page n (counting from 0), its contents and the shared objects it uses
+        auto page(const hint_tables& hints, unsigned n) const -> std::vector<byte_extent>;
+
+        // the range holding one object
+        auto extent(objref ref) const -> byte_extent;
+
+    private:
+        const xref_table& xref;
+        const std::uint64_t file_size;
+        const std::uint64_t max_gap;
+        std::vector<std::uint64_t> offsets; // of every object and the trailer, sorted
+    };
+
+    // the total length of extents
+    auto total_length(const std::vector<byte_extent>& extents) noexcept -> std::uint64_t;
+
+}
+
+#endif
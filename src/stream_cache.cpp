@@ -0,0 +1,97 @@
+#include "stream_cache.hpp"
+#include "filters.hpp"
+#include "pdfp.hpp"
+
+namespace {
+
+    auto key(pdf::objref ref) -> std::uint64_t {
+        return static_cast<std::uint64_t>(static_cast<unsigned>(ref.id)) << 32 | static_cast<unsigned>(ref.gen);
+    }
+
+}
+
+namespace pdf {
+
+    auto stream_cache::get(objref ref) -> buffer {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto data = find(ref);
+        ++(data ? _stats.hits : _stats.misses);
+        return data;
+    }
+
+    auto stream_cache::get(objref ref, const std::function<auto () -> std::vector<char>>& decode) -> buffer {
+        if (auto data = get(ref))
+            return data;
+        // decode without holding the lock, so other threads aren't kept waiting
+        return insert(ref, decode());
+    }
+
+    auto stream_cache::get(const indirect_object& object) -> buffer {
+        if (!object.stream)
+            throw pdf_error("stream_cache: object has no stream");
+        return get(object.ref, [&] { return decode_stream(object.object, *object.stream); });
+    }
+
+    auto stream_cache::insert(objref ref, std::vector<char> data) -> buffer {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (auto cached = find(ref))
+            return cached;
+        auto length = data.size();
+        auto result = std::make_shared<const std::vector<char>>(std::move(data));
+        if (length > _budget)
+            return result;
+        evict(length);
+        entries.push_front(entry{ key(ref), result });
+        index[key(ref)] = entries.begin();
+        _size += length;
+        return result;
+    }
+
+    void stream_cache::erase(objref ref) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto i = index.find(key(ref));
+        if (i == index.end())
+            return;
+        _size -= i->second->data->size();
+        entries.erase(i->second);
+        index.erase(i);
+    }
+
+    auto stream_cache::size() const -> std::size_t {
+        std::lock_guard<std::mutex> lock(mutex);
+        return _size;
+    }
+
+    auto stream_cache::stats() const -> counters {
+        std::lock_guard<std::mutex> lock(mutex);
+        return _stats;
+    }
+
+    // with the lock held: the data for ref, which becomes the most recently used
+    auto stream_cache::find(objref ref) -> buffer {
+        auto i = index.find(key(ref));
+        if (i == index.end())
+            return nullptr;
+        entries.splice(entries.begin(), entries, i->second);
+        return i->second->data;
+    }
+
+    /*
+        With the lock held: evict the least recently used data until needed more bytes
+        fit in the budget, or only pinned data is left. Buffers are only shared outside
+        the cache by copying one that get or insert returned, so a use count of 1 seen
+        with the lock held means nobody else has it.
+    */
+    void stream_cache::evict(std::size_t needed) {
+        for (auto i = entries.end(); i != entries.begin() && _size + needed > _budget;) {
+            --i;
+            if (i->data.use_count() > 1)
+                continue;
+            _size -= i->data->size();
+            index.erase(i->key);
+            i = entries.erase(i);
+            ++_stats.evictions;
+        }
+    }
+
+}
@@ -0,0 +1,87 @@
+#ifndef STREAM_CACHE_HPP
+#define STREAM_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "parser.hpp"
+#include "tools.hpp"
+
+namespace pdf {
+
+    using tools::objref;
+
+    /*
+        Keeps the decoded data of recently used streams, such as shared forms, fonts
+        and object streams, so they aren't decoded again on every use. The data is kept
+        within a budget of bytes by evicting the least recently used streams first.
+
+        The buffers handed out stay valid for as long as they are held, and a held
+        buffer is pinned: it isn't evicted, so pinned data can take the cache over its
+        budget. A stream larger than the whole budget is decoded but not kept. It is
+        safe to use from several threads, though two threads missing on the same stream
+        both decode it, and the first to finish is kept.
+    */
+    class stream_cache {
+    public:
+        using buffer = std::shared_ptr<const std::vector<char>>;
+
+        struct counters {
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+            std::uint64_t evictions = 0;
+        };
+
+        explicit stream_cache(std::size_t budget) : _budget(budget) {}
+
+        stream_cache(const stream_cache&) = delete;
+        auto operator=(const stream_cache&) -> stream_cache& = delete;
+
+        // the cached data for ref, or nullptr
+        auto get(objref ref) -> buffer;
+
+        // the cached data for ref, or else the result of decode, which is then cached
+        auto get(objref ref, const std::function<auto () -> std::vector<char>>& decode) -> buffer;
+
+        // the decoded data of a stream object, which throws pdf_error if it has no stream
+        auto get(const indirect_object& object) -> buffer;
+
+        // cache data for ref, unless it is already cached, and return what is cached
+        auto insert(objref ref, std::vector<char> data) -> buffer;
+
+        // drop ref from the cache, though anyone holding its data keeps it
+        void erase(objref ref);
+
+        auto budget() const noexcept -> std::size_t { return _budget; }
+
+        // the bytes of data held by the cache, pinned or not
+        auto size() const -> std::size_t;
+
+        auto stats() const -> counters;
+
+    private:
+        struct entry {
+            std::uint64_t key;
+            buffer data;
+        };
+
+        const std::size_t _budget;
+        mutable std::mutex mutex;
+        std::list<entry> entries; // most recently used first
+        std::unordered_map<std::uint64_t, std::list<entry>::iterator> index;
+        std::size_t _size = 0;
+        counters _stats;
+
+        auto find(objref ref) -> buffer;
+        void evict(std::size_t needed);
+    };
+
+}
+
+#endif
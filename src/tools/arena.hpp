@@ -0,0 +1,60 @@
+#ifndef TOOLS_ARENA_HPP
+#define TOOLS_ARENA_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace pdf { namespace tools {
+
+    /*
+        Hands out memory from large blocks, which are only freed all at once, when the
+        arena is destroyed. Allocations larger than a block get a block of their own.
+        The most recent allocation can be shrunk, returning its end to the arena.
+    */
+    class arena {
+    public:
+        explicit arena(std::size_t block_size = 1 << 20) : block_size(std::max<std::size_t>(block_size, 1)) {}
+
+        arena(const arena&) = delete;
+        auto operator=(const arena&) -> arena& = delete;
+
+        auto allocate(std::size_t length) -> char* {
+            if (length > available) {
+                auto size = std::max(length, block_size);
+                blocks.emplace_back(new char[size]);
+                next = blocks.back().get();
+                available = size;
+                total += size;
+            }
+            auto p = next;
+            next += length;
+            available -= length;
+            last = p;
+            return p;
+        }
+
+        // shrink the most recent allocation, p, from length to new_length bytes
+        void shrink(char* p, std::size_t length, std::size_t new_length) noexcept {
+            if (p == last && p + length == next && new_length <= length) {
+                next = p + new_length;
+                available += length - new_length;
+            }
+        }
+
+        // the total size of the blocks allocated
+        auto size() const noexcept -> std::size_t { return total; }
+
+    private:
+        const std::size_t block_size;
+        std::vector<std::unique_ptr<char[]>> blocks;
+        char* next = nullptr;
+        char* last = nullptr;
+        std::size_t available = 0;
+        std::size_t total = 0;
+    };
+
+}}
+
+#endif
@@ -13,12 +13,14 @@ namespace pdf {
 
     enum keywords : atom_type {
         _start_keywords_ = 1000, // not used
-        f, _false, n, null, R, trailer, _true, startxref, xref
+        endobj, endstream, f, _false, n, null, obj, R, stream, trailer, _true, startxref, xref
     };
 
     enum names : atom_type {
         _start_names_ = 2000, // not used
-        ID, Info, Prev, Root, Size
+        ASCII85Decode, ASCIIHexDecode, BitsPerComponent, Catalog, Colors, Columns, DecodeParms, DL, E,
+        EarlyChange, Filter, First, FlateDecode, H, ID, Index, Info, L, Length, Linearized, LZWDecode,
+        N, O, ObjStm, Predictor, Prev, Root, S, Size, T, Type, W, XRef, XRefStm
     };
 
 }
@@ -0,0 +1,61 @@
+#ifndef TOOLS_RING_BUFFER_HPP
+#define TOOLS_RING_BUFFER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "slice.hpp"
+
+namespace pdf { namespace tools {
+
+    /*
+        A fixed size byte queue. Data is written at the back and read from the front,
+        in place: back() is the free space which can be written without wrapping, and
+        front() the data which can be read without wrapping.
+    */
+    class ring_buffer {
+    public:
+        explicit ring_buffer(std::size_t capacity) : data(new char[std::max<std::size_t>(capacity, 1)]),
+                                                     _capacity(std::max<std::size_t>(capacity, 1)) {}
+
+        auto size() const noexcept -> std::size_t { return count; }
+        auto capacity() const noexcept -> std::size_t { return _capacity; }
+        auto empty() const noexcept -> bool { return count == 0; }
+        auto full() const noexcept -> bool { return count == _capacity; }
+
+        auto front() const noexcept -> slice {
+            auto p = data.get() + head;
+            return slice(p, p + std::min(count, _capacity - head));
+        }
+
+        // remove n bytes from the front
+        void consume(std::size_t n) noexcept {
+            n = std::min(n, count);
+            count -= n;
+            // start again from the beginning when empty, so writes wrap less
+            head = count == 0 ? 0 : (head + n) % _capacity;
+        }
+
+        auto back() noexcept -> std::pair<char*, std::size_t> {
+            auto tail = (head + count) % _capacity;
+            auto room = full() ? 0 : tail >= head ? _capacity - tail : head - tail;
+            return { data.get() + tail, room };
+        }
+
+        // add the n bytes written at back()
+        void commit(std::size_t n) noexcept {
+            count += std::min(n, _capacity - count);
+        }
+
+    private:
+        std::unique_ptr<char[]> data;
+        std::size_t _capacity;
+        std::size_t head = 0;
+        std::size_t count = 0;
+    };
+
+}}
+
+#endif
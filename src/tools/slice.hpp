@@ -3,6 +3,8 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstring>
 #include <stdexcept>
 #include <functional>
 
@@ -31,7 +33,7 @@ namespace pdf { namespace tools {
             _end = end;
         }
 
-        slice(cptr begin, unsigned int length) {
+        slice(cptr begin, std::size_t length) {
             assert(begin != nullptr);
             _begin = begin;
             _end = _begin + length;
@@ -41,14 +43,18 @@ namespace pdf { namespace tools {
 
         auto begin() const noexcept -> cptr { return _begin; }
         auto end() const noexcept -> cptr { return _end; }
-        auto length() const noexcept -> unsigned int { return _end - _begin; }
+        auto length() const noexcept -> std::size_t { return _end - _begin; }
         auto empty() const noexcept -> bool { return _begin == _end; }
 
-        auto left(unsigned int length) const noexcept -> slice {
+        auto left(std::size_t length) const noexcept -> slice {
             return slice(_begin, _begin + std::min(this->length(), length));
         }
 
-        auto remove_left(unsigned int length) const noexcept -> slice {
+        auto right(std::size_t length) const noexcept -> slice {
+            return slice(_end - std::min(this->length(), length), _end);
+        }
+
+        auto remove_left(std::size_t length) const noexcept -> slice {
             return slice(_begin + std::min(this->length(), length), _end);
         }
 
@@ -73,7 +79,7 @@ namespace pdf { namespace tools {
             return empty() ? *this : slice(_begin + 1, _end);
         }
 
-        auto operator[](int i) const noexcept -> char {
+        auto operator[](std::ptrdiff_t i) const noexcept -> char {
             return _begin[i];
         }
 
@@ -81,7 +87,7 @@ namespace pdf { namespace tools {
             return left(s.length()) == s;
         }
 
-        auto skip(unsigned int n) const noexcept -> slice {
+        auto skip(std::size_t n) const noexcept -> slice {
             return slice(begin() + std::min(n, length()), end());
         }
 
@@ -119,11 +125,38 @@ namespace pdf { namespace tools {
             return slice(begin(), p);
         }
 
+        /*
+            Candidate positions are located with memchr, which most C libraries
+            vectorize, so this is much faster than std::search on large inputs.
+        */
+        auto find_first(slice what) const noexcept -> slice {
+            if (what.empty())
+                return *this;
+            auto p = begin();
+            auto last = end() - std::min(length(), what.length() - 1);
+            while (p < last) {
+                p = static_cast<cptr>(std::memchr(p, what[0], last - p));
+                if (p == nullptr)
+                    break;
+                if (std::memcmp(p, what.begin(), what.length()) == 0)
+                    return slice(p, end());
+                ++p;
+            }
+            return slice("");
+        }
+
+        /*
+            Searches backwards from the end, so only the part of the slice after
+            the match is ever read.
+        */
         auto find_last(slice what) const noexcept -> slice {
-            auto p = std::find_end(begin(), end(), what.begin(), what.end());
-            return p == end()
-                ? slice("")
-                : slice(p, end());
+            if (what.empty() || what.length() > length())
+                return slice("");
+            auto last = what[what.length() - 1];
+            for (auto p = end(); p - begin() >= static_cast<std::ptrdiff_t>(what.length()); --p)
+                if (p[-1] == last && std::memcmp(p - what.length(), what.begin(), what.length()) == 0)
+                    return slice(p - what.length(), end());
+            return slice("");
         }
 
     private:
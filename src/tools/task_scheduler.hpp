@@ -0,0 +1,184 @@
+#ifndef TOOLS_TASK_SCHEDULER_HPP
+#define TOOLS_TASK_SCHEDULER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pdf { namespace tools {
+
+    /*
+        A pool of worker threads which balance uneven work by stealing. Each worker has
+        its own queue: it takes its newest task first, and when it runs dry, takes the
+        oldest task of another worker. Tasks get the index of the worker running them,
+        so they can use per-worker state, such as an arena, without locking.
+
+        for_each splits its range in halves, keeping one half and queueing the other,
+        so the oldest tasks are the largest, and a thief takes half of what is left.
+        The destructor waits for all queued tasks to finish.
+    */
+    class task_scheduler {
+    public:
+        using task = std::function<void(unsigned)>;
+
+        explicit task_scheduler(unsigned threads = std::thread::hardware_concurrency()) {
+            threads = std::max(threads, 1u);
+            for (unsigned i = 0; i < threads; ++i)
+                queues.emplace_back(new queue());
+            for (unsigned i = 0; i < threads; ++i)
+                workers.emplace_back([this, i] { work(i); });
+        }
+
+        ~task_scheduler() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            ready.notify_all();
+            for (auto& worker : workers)
+                worker.join();
+        }
+
+        task_scheduler(const task_scheduler&) = delete;
+        auto operator=(const task_scheduler&) -> task_scheduler& = delete;
+
+        auto size() const noexcept -> unsigned { return static_cast<unsigned>(workers.size()); }
+
+        // run f(worker) on one of the workers
+        template <typename F>
+        auto submit(F f) -> std::future<decltype(f(0u))> {
+            // std::function must be copyable, but packaged_tasks aren't
+            auto t = std::make_shared<std::packaged_task<decltype(f(0u))(unsigned)>>(std::move(f));
+            auto result = t->get_future();
+            push([t](unsigned worker) { (*t)(worker); });
+            return result;
+        }
+
+        /*
+            Run f(i, worker) for every i from 0 to count, and wait for all of them. The
+            first exception thrown by f is rethrown here, once the rest have finished.
+            Must not be called from a task, which would wait on its own worker.
+        */
+        template <typename F>
+        void for_each(std::size_t count, F f) {
+            if (count == 0)
+                return;
+            auto state = std::make_shared<batch>(count);
+            auto body = std::make_shared<F>(std::move(f));
+            push([this, state, body](unsigned worker) { run_range(state, body, 0, state->count, worker); });
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->finished.wait(lock, [&] { return state->remaining == 0; });
+            if (state->error)
+                std::rethrow_exception(state->error);
+        }
+
+    private:
+        struct queue {
+            std::mutex mutex;
+            std::deque<task> tasks;
+        };
+
+        struct batch {
+            explicit batch(std::size_t count) : count(count), remaining(count) {}
+            const std::size_t count;
+            std::mutex mutex;
+            std::condition_variable finished;
+            std::size_t remaining;
+            std::exception_ptr error;
+        };
+
+        std::vector<std::unique_ptr<queue>> queues;
+        std::vector<std::thread> workers;
+        std::mutex mutex; // guards sleeping and stopping
+        std::condition_variable ready;
+        std::atomic<std::size_t> queued{ 0 };
+        std::atomic<unsigned> next{ 0 };
+        bool stopping = false;
+
+        // the scheduler and worker index of the calling thread, if it is a worker
+        static auto current() noexcept -> std::pair<task_scheduler*, unsigned>& {
+            static thread_local std::pair<task_scheduler*, unsigned> worker{ nullptr, 0 };
+            return worker;
+        }
+
+        // onto the calling worker's own queue, or else spread over the queues in turn
+        void push(task t) {
+            auto self = current();
+            auto i = self.first == this ? self.second : next++ % size();
+            {
+                std::lock_guard<std::mutex> lock(queues[i]->mutex);
+                queues[i]->tasks.push_back(std::move(t));
+            }
+            ++queued;
+            // taking the lock orders this with a worker checking queued before it sleeps
+            { std::lock_guard<std::mutex> lock(mutex); }
+            ready.notify_one();
+        }
+
+        auto pop(unsigned self, task& t) -> bool {
+            for (unsigned n = 0; n < size(); ++n) {
+                auto& q = *queues[(self + n) % size()];
+                std::lock_guard<std::mutex> lock(q.mutex);
+                if (q.tasks.empty())
+                    continue;
+                if (n == 0) {
+                    t = std::move(q.tasks.back());
+                    q.tasks.pop_back();
+                } else {
+                    t = std::move(q.tasks.front());
+                    q.tasks.pop_front();
+                }
+                --queued;
+                return true;
+            }
+            return false;
+        }
+
+        void work(unsigned self) {
+            current() = { this, self };
+            for (;;) {
+                task t;
+                if (pop(self, t)) {
+                    t(self);
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [this] { return stopping || queued > 0; });
+                if (stopping && queued == 0)
+                    return;
+            }
+        }
+
+        template <typename F>
+        void run_range(std::shared_ptr<batch> state, std::shared_ptr<F> body, std::size_t begin, std::size_t end,
+                       unsigned worker) {
+            while (end - begin > 1) {
+                auto middle = begin + (end - begin) / 2;
+                push([this, state, body, middle, end](unsigned w) { run_range(state, body, middle, end, w); });
+                end = middle;
+            }
+            std::exception_ptr error;
+            try {
+                (*body)(begin, worker);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (error && !state->error)
+                state->error = error;
+            if (--state->remaining == 0)
+                state->finished.notify_all();
+        }
+    };
+
+}}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef TOOLS_THREAD_POOL_HPP
+#define TOOLS_THREAD_POOL_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace pdf { namespace tools {
+
+    /*
+        A fixed size pool of worker threads. Tasks run in the order they are submitted.
+        The destructor waits for all submitted tasks to finish.
+    */
+    class thread_pool {
+    public:
+        explicit thread_pool(unsigned threads = std::thread::hardware_concurrency()) {
+            threads = std::max(threads, 1u);
+            for (unsigned i = 0; i < threads; ++i)
+                workers.emplace_back([this] { work(); });
+        }
+
+        ~thread_pool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            ready.notify_all();
+            for (auto& worker : workers)
+                worker.join();
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        auto operator=(const thread_pool&) -> thread_pool& = delete;
+
+        auto size() const noexcept -> unsigned { return workers.size(); }
+
+        template <typename F>
+        auto submit(F f) -> std::future<decltype(f())> {
+            // std::function must be copyable, but packaged_tasks aren't
+            auto task = std::make_shared<std::packaged_task<decltype(f())()>>(std::move(f));
+            auto result = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.emplace([task] { (*task)(); });
+            }
+            ready.notify_one();
+            return result;
+        }
+
+    private:
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable ready;
+        bool stopping = false;
+
+        void work() {
+            for (;;) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+                    if (tasks.empty())
+                        return;
+                    task = std::move(tasks.front());
+                    tasks.pop();
+                }
+                task();
+            }
+        }
+    };
+
+}}
+
+#endif
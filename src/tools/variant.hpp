@@ -122,7 +122,7 @@ namespace pdf { namespace tools {
             return variant(value);
         }
 
-        static auto make_integer(int value) noexcept -> variant {
+        static auto make_integer(long long value) noexcept -> variant {
             return variant(value);
         }
 
@@ -172,7 +172,7 @@ namespace pdf { namespace tools {
             return is_boolean() && _var.bool_val == value;
         }
 
-        auto is_integer(int value) const noexcept -> bool {
+        auto is_integer(long long value) const noexcept -> bool {
             return is_integer() && _var.int_val == value;
         }
 
@@ -207,7 +207,7 @@ namespace pdf { namespace tools {
             return _var.bool_val;
         }
 
-        auto get_integer() const -> int {
+        auto get_integer() const -> long long {
             if (!is_integer()) throw std::runtime_error("variant: not an integer");
             return _var.int_val;
         }
@@ -272,7 +272,7 @@ namespace pdf { namespace tools {
         variant(variant_type type) : _type(type) {}
         variant(atom_type value, variant_type type) : _type(type) { _var.atom = value; }
         variant(bool value) : _type(variant_type::boolean) { _var.bool_val = value; }
-        variant(int value) : _type(variant_type::integer) { _var.int_val = value; }
+        variant(long long value) : _type(variant_type::integer) { _var.int_val = value; }
         variant(double value) : _type(variant_type::real) { _var.real_val = value; }
         variant(slice value, variant_type type) : _type(type) { _var.str = value; }
         variant(objref value) : _type(variant_type::ref) { _var.ref = value; }
@@ -285,7 +285,7 @@ namespace pdf { namespace tools {
             slice str;
             atom_type atom;
             bool bool_val;
-            int int_val;
+            long long int_val;
             double real_val;
             array_type* array;
             dict_type* dict;
@@ -0,0 +1,191 @@
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+#include "mapped_file.hpp"
+#include "pdfp.hpp"
+#include "xref_cache.hpp"
+
+namespace {
+
+    using pdf::xref_entries;
+    using pdf::xref_entry;
+
+    const std::uint64_t magic = 0x3146525850464450; // "PDFPXRF1"
+    const std::uint64_t version = 1;
+    const unsigned tail_length = 4096;
+
+    struct header {
+        std::uint64_t magic;
+        std::uint64_t version;
+        std::uint64_t size;
+        std::int64_t mtime;
+        std::uint64_t tail_hash;
+        std::uint64_t entries;
+        std::uint64_t pages;
+        std::uint64_t trailer_offset;
+        std::uint64_t flags;
+        std::uint64_t catalog_id;
+        std::uint64_t catalog_gen;
+    };
+
+    const std::uint64_t reconstructed = 1;
+
+    static_assert(sizeof(xref_entry) == sizeof(std::uint64_t), "xref entries are stored as 64 bit words");
+
+    // each page is stored as its page number followed by its entries
+    const std::size_t page_words = 1 + xref_entries::page_size;
+
+    void write_all(int fd, const void* data, std::size_t length) {
+        auto p = static_cast<const char*>(data);
+        while (length > 0) {
+            auto r = ::write(fd, p, length);
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r <= 0)
+                throw pdf::pdf_error("save_xref_cache: can't write cache file");
+            p += r;
+            length -= r;
+        }
+    }
+
+    // 64 bit FNV-1a
+    auto hash(pdf::tools::slice s) noexcept -> std::uint64_t {
+        std::uint64_t h = 0xcbf29ce484222325;
+        for (auto ch : s) {
+            h ^= static_cast<unsigned char>(ch);
+            h *= 0x100000001b3;
+        }
+        return h;
+    }
+
+    /*
+        Check the raw entries of a page, so a damaged cache is rejected rather than
+        trusted: every type must be known, every offset inside the file, and every
+        object stream one of the objects.
+    */
+    auto valid_page(const std::uint64_t* page, std::uint64_t file_size, std::uint64_t entries) noexcept -> bool {
+        for (std::size_t i = 0; i < xref_entries::page_size; ++i) {
+            if (page[i] >> 56 > static_cast<unsigned>(pdf::xref_type::compressed))
+                return false;
+            auto entry = xref_entry::from_raw(page[i]);
+            if (entry.type() == pdf::xref_type::in_use && entry.offset() >= file_size)
+                return false;
+            if (entry.type() == pdf::xref_type::compressed && entry.stream() >= entries)
+                return false;
+        }
+        return true;
+    }
+
+}
+
+namespace pdf {
+
+    auto make_xref_cache_key(const std::string& filename, const byte_source& input) -> xref_cache_key {
+        struct stat st;
+        if (stat(filename.c_str(), &st) != 0)
+            throw pdf_error("make_xref_cache_key: can't stat file");
+        xref_cache_key key;
+        key.size = input.size();
+        key.mtime = st.st_mtime;
+        key.tail_hash = hash(input.read(input.size() - std::min<std::uint64_t>(input.size(), tail_length),
+                                        tail_length).data);
+        return key;
+    }
+
+    auto load_xref_cache(const std::string& path, const xref_cache_key& key, xref_table& xref) -> bool {
+        mapped_file file;
+        try {
+            file = mapped_file(path);
+        } catch (pdf_error&) {
+            return false;
+        }
+        if (file.size() % sizeof(std::uint64_t) != 0 || file.size() < sizeof(header))
+            return false;
+        // mappings are page aligned, so the words can be read in place
+        auto words = reinterpret_cast<const std::uint64_t*>(file.data().begin());
+        auto count = file.size() / sizeof(std::uint64_t);
+        auto h = reinterpret_cast<const header*>(words);
+        if (h->magic != magic || h->version != version
+            || h->size != key.size || h->mtime != key.mtime || h->tail_hash != key.tail_hash)
+            return false;
+        std::size_t first = sizeof(header) / sizeof(words[0]);
+        if (h->entries > 8388608 || h->pages > count || count != first + h->pages * page_words)
+            return false;
+
+        // the pages are used straight from the mapping, which they keep open
+        auto mapping = std::make_shared<mapped_file>(std::move(file));
+        xref_entries entries;
+        entries.resize(static_cast<unsigned>(h->entries));
+        for (std::size_t i = 0; i < h->pages; ++i) {
+            auto page = &words[first + i * page_words];
+            if (page[0] >= entries.page_count() || !valid_page(page + 1, key.size, h->entries))
+                return false;
+            entries.borrow_page(static_cast<unsigned>(page[0]), reinterpret_cast<const xref_entry*>(page + 1), mapping);
+        }
+        try {
+            xref.restore(std::move(entries), h->trailer_offset, (h->flags & reconstructed) != 0,
+                         objref(static_cast<int>(h->catalog_id), static_cast<int>(h->catalog_gen)));
+        } catch (std::runtime_error&) {
+            // the trailer couldn't be read back, so the cache doesn't belong to this file
+            return false;
+        }
+        return true;
+    }
+
+    void save_xref_cache(const std::string& path, const xref_cache_key& key, const xref_table& xref) {
+        const auto& entries = xref.entries();
+        header h = {};
+        h.magic = magic;
+        h.version = version;
+        h.size = key.size;
+        h.mtime = key.mtime;
+        h.tail_hash = key.tail_hash;
+        h.entries = entries.size();
+        for (unsigned n = 0; n < entries.page_count(); ++n)
+            if (entries.page(n) != nullptr)
+                ++h.pages;
+        h.trailer_offset = xref.trailer_offset();
+        h.flags = xref.reconstructed() ? reconstructed : 0;
+        h.catalog_id = xref.catalog().id;
+        h.catalog_gen = xref.catalog().gen;
+
+        /*
+            Write to a temporary file of its own first, next to the cache so it can be
+            renamed over it. A concurrent open never sees a partial cache, and concurrent
+            saves don't write into each other's files.
+        */
+        auto temp = path + ".XXXXXX";
+        int fd = mkstemp(&temp[0]);
+        if (fd < 0)
+            throw pdf_error("save_xref_cache: can't create cache file");
+        try {
+            write_all(fd, &h, sizeof h);
+            for (unsigned n = 0; n < entries.page_count(); ++n) {
+                auto page = entries.page(n);
+                if (page == nullptr)
+                    continue;
+                std::uint64_t number = n;
+                write_all(fd, &number, sizeof number);
+                write_all(fd, page, xref_entries::page_size * sizeof(xref_entry));
+            }
+        } catch (...) {
+            close(fd);
+            unlink(temp.c_str());
+            throw;
+        }
+        if (close(fd) != 0) {
+            unlink(temp.c_str());
+            throw pdf_error("save_xref_cache: can't write cache file");
+        }
+        if (std::rename(temp.c_str(), path.c_str()) != 0) {
+            unlink(temp.c_str());
+            throw pdf_error("save_xref_cache: can't replace cache file");
+        }
+    }
+
+}
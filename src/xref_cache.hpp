@@ -0,0 +1,48 @@
+#ifndef XREF_CACHE_HPP
+#define XREF_CACHE_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "byte_source.hpp"
+#include "tools.hpp"
+#include "xref_table.hpp"
+
+namespace pdf {
+
+    using tools::slice;
+
+    /*
+        Identifies the version of a pdf file an xref cache was made from. Incremental
+        updates change the end of a file, so a hash of its tail catches most edits
+        which leave the size and modification time alone.
+    */
+    struct xref_cache_key {
+        std::uint64_t size = 0;
+        std::int64_t mtime = 0;
+        std::uint64_t tail_hash = 0;
+    };
+
+    // throws pdf_error if filename can't be examined
+    auto make_xref_cache_key(const std::string& filename, const byte_source& input) -> xref_cache_key;
+
+    /*
+        The xref cache is a sidecar file holding a resolved xref table, so that
+        opening the same file again doesn't need to parse any xref sections.
+
+        The file consists of 64 bit words in native byte order: a header followed by
+        each allocated page of packed xref entries, prefixed by its page number. The
+        entries are stored exactly as they are kept in memory, so once they have been
+        checked, the table uses them directly from a mapping of the file, which it
+        keeps open. Only pages in which an entry is later changed are copied.
+    */
+
+    // restores xref from the cache at path, returns false if it is missing, stale or damaged
+    auto load_xref_cache(const std::string& path, const xref_cache_key& key, xref_table& xref) -> bool;
+
+    // throws pdf_error if the cache can't be written
+    void save_xref_cache(const std::string& path, const xref_cache_key& key, const xref_table& xref);
+
+}
+
+#endif
@@ -0,0 +1,162 @@
+#include <future>
+
+#include "xref_scanner.hpp"
+
+namespace {
+
+    using pdf::scan_result;
+    using pdf::scanned_object;
+    using pdf::tools::slice;
+
+    // the maximum object number permitted by the PDF specification
+    const unsigned max_object_id = 8388607;
+
+    auto iswhitespace(char ch) noexcept -> bool {
+        switch (ch) {
+            case 0x00: case 0x09: case 0x0a:
+            case 0x0c: case 0x0d: case 0x20: return true;
+            default: return false;
+        }
+    }
+
+    auto isdelimiter(char ch) noexcept -> bool {
+        switch (ch) {
+            case '(': case ')': case '<': case '>':
+            case '[': case ']': case '{': case '}':
+            case '/': case '%': return true;
+            default: return false;
+        }
+    }
+
+    auto isdigit(char ch) noexcept -> bool {
+        return ch >= '0' && ch <= '9';
+    }
+
+    /*
+        Skip backwards over characters matching pred, but no further than limit.
+    */
+    template <typename Pred>
+    auto back_while(const char* p, const char* begin, unsigned limit, Pred pred) noexcept -> const char* {
+        while (p > begin && limit-- > 0 && pred(p[-1]))
+            --p;
+        return p;
+    }
+
+    auto to_unsigned(const char* begin, const char* end) noexcept -> unsigned {
+        unsigned value = 0;
+        for (auto p = begin; p != end; ++p)
+            value = value * 10 + (*p - '0');
+        return value;
+    }
+
+    /*
+        Check that the obj keyword at p is preceded by an object number and generation,
+        and work out where the header begins. The whole input is visible, so a header
+        which starts in the previous chunk is still recognized.
+    */
+    auto object_header(slice input, const char* p, scanned_object& object) noexcept -> bool {
+        auto end = p + 3;
+        if (end != input.end() && !iswhitespace(*end) && !isdelimiter(*end))
+            return false;
+        auto gen_end = back_while(p, input.begin(), 32, iswhitespace);
+        if (gen_end == p)
+            return false;
+        auto gen_begin = back_while(gen_end, input.begin(), 5, isdigit);
+        if (gen_begin == gen_end)
+            return false;
+        auto id_end = back_while(gen_begin, input.begin(), 32, iswhitespace);
+        if (id_end == gen_begin)
+            return false;
+        auto id_begin = back_while(id_end, input.begin(), 7, isdigit);
+        if (id_begin == id_end)
+            return false;
+        if (id_begin != input.begin() && !iswhitespace(id_begin[-1]) && !isdelimiter(id_begin[-1]))
+            return false;
+        unsigned id = to_unsigned(id_begin, id_end);
+        unsigned gen = to_unsigned(gen_begin, gen_end);
+        if (id > max_object_id || gen > 0xffff)
+            return false;
+        object = scanned_object(id, gen, id_begin - input.begin());
+        return true;
+    }
+
+    /*
+        Scan for keywords starting in [first, last). Matches may extend past last,
+        which stitches together keywords split across chunk boundaries.
+    */
+    auto scan_chunk(slice input, std::size_t first, std::size_t last) -> scan_result {
+        scan_result result;
+        slice chunk(input.begin() + first, input.begin() + std::min(last + 2, input.length()));
+        for (slice s = chunk.find_first("obj"); !s.empty(); s = s.skip(3).find_first("obj")) {
+            scanned_object object(0, 0, 0);
+            if (object_header(input, s.begin(), object))
+                result.objects.push_back(object);
+        }
+        chunk = slice(input.begin() + first, input.begin() + std::min(last + 6, input.length()));
+        for (slice s = chunk.find_first("trailer"); !s.empty(); s = s.skip(7).find_first("trailer"))
+            result.trailers.push_back(s.begin() - input.begin());
+        return result;
+    }
+
+    // enough of the previous part for object_header to look back over
+    const std::size_t max_header_length = 80;
+    // a keyword starting this close to the end of a part might continue in the next
+    const std::size_t max_keyword_length = 8;
+
+}
+
+namespace pdf {
+
+    auto scan_objects(slice input, tools::thread_pool& pool, std::size_t chunk_size) -> scan_result {
+        chunk_size = std::max<std::size_t>(chunk_size, 1);
+        std::vector<std::future<scan_result>> chunks;
+        for (std::size_t first = 0; first < input.length(); first += std::min(chunk_size, input.length() - first)) {
+            auto last = first + std::min(chunk_size, input.length() - first);
+            chunks.push_back(pool.submit([=] { return scan_chunk(input, first, last); }));
+        }
+
+        scan_result result;
+        for (auto& chunk : chunks) {
+            auto r = chunk.get();
+            result.objects.insert(result.objects.end(), r.objects.begin(), r.objects.end());
+            result.trailers.insert(result.trailers.end(), r.trailers.begin(), r.trailers.end());
+        }
+        return result;
+    }
+
+    void object_scanner::scan(slice part) {
+        carry.append(part.begin(), part.length());
+        auto end = carry_offset + carry.length();
+        if (end - scanned > max_keyword_length)
+            scan_to(slice(carry.data(), carry.length()), end - max_keyword_length);
+        if (carry.length() > max_header_length + max_keyword_length) {
+            auto drop = carry.length() - max_header_length - max_keyword_length;
+            carry.erase(0, drop);
+            carry_offset += drop;
+        }
+    }
+
+    auto object_scanner::finish() -> const scan_result& {
+        scan_to(slice(carry.data(), carry.length()), carry_offset + carry.length());
+        return _result;
+    }
+
+    /*
+        Find the keywords starting in [scanned, last), where input holds the file
+        from carry_offset on.
+    */
+    void object_scanner::scan_to(slice input, std::uint64_t last) {
+        if (last <= scanned)
+            return;
+        auto r = scan_chunk(input, static_cast<std::size_t>(scanned - carry_offset),
+                            static_cast<std::size_t>(last - carry_offset));
+        for (auto& object : r.objects) {
+            object.offset += carry_offset;
+            _result.objects.push_back(object);
+        }
+        for (auto trailer : r.trailers)
+            _result.trailers.push_back(trailer + carry_offset);
+        scanned = last;
+    }
+
+}
@@ -0,0 +1,60 @@
+#ifndef XREF_SCANNER_HPP
+#define XREF_SCANNER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tools.hpp"
+#include "tools/thread_pool.hpp"
+
+namespace pdf {
+
+    using tools::slice;
+
+    struct scanned_object {
+        scanned_object(unsigned id, unsigned gen, std::uint64_t offset) : id(id), gen(gen), offset(offset) {}
+        unsigned id, gen;
+        std::uint64_t offset; // of the object header ("N G obj")
+    };
+
+    struct scan_result {
+        std::vector<scanned_object> objects; // in file order
+        std::vector<std::uint64_t> trailers; // offsets of trailer keywords, in file order
+    };
+
+    /*
+        Find every object header and trailer keyword in a pdf file without using
+        the xref table, for rebuilding the xref table of a damaged file.
+        The input is split into chunks of (at least) chunk_size bytes which are
+        scanned concurrently.
+    */
+    auto scan_objects(slice input, tools::thread_pool& pool, std::size_t chunk_size = 1 << 22) -> scan_result;
+
+    /*
+        Scans a pdf file for the same things as scan_objects, as it arrives in parts,
+        e.g. from a pipe. Only the last few bytes of each part are kept, for headers
+        and keywords which continue in the next part.
+    */
+    class object_scanner {
+    public:
+        // scan the next part of the file
+        void scan(slice part);
+
+        // scan what remains of the file once it has all arrived
+        auto finish() -> const scan_result&;
+
+        auto result() const noexcept -> const scan_result& { return _result; }
+
+    private:
+        std::string carry; // the end of the file so far
+        std::uint64_t carry_offset = 0; // of carry in the file
+        std::uint64_t scanned = 0; // keywords starting before this offset have been found
+        scan_result _result;
+
+        void scan_to(slice input, std::uint64_t last);
+    };
+
+}
+
+#endif
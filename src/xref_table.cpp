@@ -1,18 +1,566 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <set>
+#include <thread>
 #include <tuple>
 
 #include "xref_table.hpp"
+#include "filters.hpp"
+#include "object_stream.hpp"
 #include "parser.hpp"
+#include "pdf_dictionaries.hpp"
+#include "xref_scanner.hpp"
+
+namespace {
+
+    using pdf::xref_entry;
+    using pdf::xref_type;
+    using pdf::tools::slice;
+
+    // classic xref entries are exactly 20 bytes long: "oooooooooo ggggg n\r\n"
+    const unsigned entry_size = 20;
+
+    // the maximum object number permitted by the PDF specification
+    const unsigned max_object_id = 8388607;
+
+    // don't bother starting a thread for fewer xref sections than this
+    const std::size_t sections_per_thread = 16;
+
+    // the spec puts %%EOF in the last 1024 bytes, but allow for trailing junk
+    const std::uint64_t startxref_window = 1 << 16;
+
+    auto isdigit(char ch) noexcept -> bool {
+        return ch >= '0' && ch <= '9';
+    }
+
+    auto iswhitespace(char ch) noexcept -> bool {
+        switch (ch) {
+            case 0x00: case 0x09: case 0x0a:
+            case 0x0c: case 0x0d: case 0x20: return true;
+            default: return false;
+        }
+    }
+
+    /*
+        Decode 8 ASCII digits at once, SIMD within a register style.
+        Returns false if any of the 8 bytes is not a digit.
+    */
+    auto parse_8_digits(const char* p, std::uint64_t& value) noexcept -> bool {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        std::uint64_t chunk;
+        std::memcpy(&chunk, p, sizeof chunk);
+        // every byte must be in 0x30..0x39
+        if ((chunk & 0xf0f0f0f0f0f0f0f0) != 0x3030303030303030 ||
+            ((chunk + 0x0606060606060606) & 0xf0f0f0f0f0f0f0f0) != 0x3030303030303030)
+            return false;
+        chunk -= 0x3030303030303030;
+        // combine adjacent digits into 2 digit values, then 2 digit values into the result
+        chunk = chunk * 10 + (chunk >> 8);
+        value = ((chunk & 0x000000ff000000ff) * (100 + (1000000ULL << 32)) +
+                 ((chunk >> 16) & 0x000000ff000000ff) * (1 + (10000ULL << 32))) >> 32;
+        return true;
+#else
+        value = 0;
+        for (int i = 0; i < 8; ++i) {
+            if (!isdigit(p[i]))
+                return false;
+            value = value * 10 + (p[i] - '0');
+        }
+        return true;
+#endif
+    }
+
+    /*
+        Decode a 20 byte xref entry without going through the tokenizer.
+        Returns false if the entry is not exactly in the format required by the spec.
+    */
+    auto decode_entry(const char* p, xref_entry& entry) noexcept -> bool {
+        std::uint64_t offset;
+        if (!parse_8_digits(p, offset) || !isdigit(p[8]) || !isdigit(p[9]) || p[10] != ' ')
+            return false;
+        offset = offset * 100 + (p[8] - '0') * 10 + (p[9] - '0');
+        unsigned gen = 0;
+        for (int i = 11; i < 16; ++i) {
+            if (!isdigit(p[i]))
+                return false;
+            gen = gen * 10 + (p[i] - '0');
+        }
+        if (p[16] != ' ' || (p[17] != 'n' && p[17] != 'f'))
+            return false;
+        if ((p[18] != ' ' && p[18] != '\r') || (p[19] != '\r' && p[19] != '\n'))
+            return false;
+        if (gen > 0xffff)
+            return false;
+        entry = xref_entry(offset, static_cast<unsigned short>(gen),
+                           p[17] == 'n' ? xref_type::in_use : xref_type::free);
+        return true;
+    }
+
+    /*
+        Read a big-endian xref stream field of N bytes.
+    */
+    template <unsigned N>
+    auto field(const unsigned char* p) noexcept -> std::uint64_t {
+        std::uint64_t value = 0;
+        for (unsigned i = 0; i < N; ++i)
+            value = value << 8 | p[i];
+        return value;
+    }
+
+    auto field(const unsigned char* p, unsigned n) noexcept -> std::uint64_t {
+        std::uint64_t value = 0;
+        for (unsigned i = 0; i < n; ++i)
+            value = value << 8 | p[i];
+        return value;
+    }
+
+    auto make_entry(std::uint64_t type, std::uint64_t field2, std::uint64_t field3) -> xref_entry {
+        switch (type) {
+            case 0:
+                return xref_entry(field2 & xref_entry::max_offset, static_cast<unsigned short>(field3), xref_type::free);
+            case 1:
+                if (field2 > xref_entry::max_offset || field3 > 0xffff)
+                    throw pdf::format_error("xref_table: invalid xref stream entry");
+                return xref_entry(field2, static_cast<unsigned short>(field3), xref_type::in_use);
+            case 2:
+                if (field2 > max_object_id || field3 > 0xffff)
+                    throw pdf::format_error("xref_table: invalid xref stream entry");
+                return xref_entry(field2, static_cast<unsigned short>(field3), xref_type::compressed);
+            default:
+                // unknown types are treated as references to the null object
+                return xref_entry(0, 0, xref_type::free);
+        }
+    }
+
+    /*
+        Row kernels for xref streams. The field widths of the common /W
+        combinations are compile time constants, so each row decodes without
+        any loops or branches on the widths.
+    */
+    template <unsigned W0, unsigned W1, unsigned W2>
+    void decode_rows(const unsigned char* p, std::size_t count, std::vector<xref_entry>& entries) {
+        for (std::size_t i = 0; i < count; ++i, p += W0 + W1 + W2)
+            // the type defaults to 1 when its field is absent
+            entries.push_back(make_entry(W0 == 0 ? 1 : field<W0>(p), field<W1>(p + W0), field<W2>(p + W0 + W1)));
+    }
+
+    void decode_rows(const std::vector<long long>& w, const unsigned char* p, std::size_t count,
+                     std::vector<xref_entry>& entries) {
+        switch (w[0] << 8 | w[1] << 4 | w[2]) {
+            case 0x111: decode_rows<1, 1, 1>(p, count, entries); break;
+            case 0x121: decode_rows<1, 2, 1>(p, count, entries); break;
+            case 0x122: decode_rows<1, 2, 2>(p, count, entries); break;
+            case 0x131: decode_rows<1, 3, 1>(p, count, entries); break;
+            case 0x132: decode_rows<1, 3, 2>(p, count, entries); break;
+            case 0x141: decode_rows<1, 4, 1>(p, count, entries); break;
+            case 0x142: decode_rows<1, 4, 2>(p, count, entries); break;
+            default: {
+                unsigned w0 = w[0], w1 = w[1], w2 = w[2];
+                for (std::size_t i = 0; i < count; ++i, p += w0 + w1 + w2)
+                    entries.push_back(make_entry(w0 == 0 ? 1 : field(p, w0), field(p + w0, w1), field(p + w0 + w1, w2)));
+                break;
+            }
+        }
+    }
+
+}
 
 namespace pdf {
 
-    void xref_table::get_previous(int offset) {
+    /*
+        Files using xref streams have no trailer keyword, so start from startxref. It is
+        near the end of the file, so only the tail of the file is read.
+    */
+    void xref_table::load(const scan_result* scanned) {
+        try {
+            auto size = source.size();
+            auto start = size - std::min<std::uint64_t>(size, startxref_window);
+            auto tail = source.read(start, startxref_window);
+            slice startxref = tail.data.find_last("startxref");
+            if (startxref.empty())
+                throw pdf_error("xref_table::load: no startxref");
+            tools::atom_table tab;
+            parser p(startxref, tab);
+            p.expect_keyword(keywords::startxref);
+            get_from(p.expect_integer(), true, start + (startxref.begin() - tail.data.begin()));
+        } catch (std::runtime_error&) {
+            // damaged file: rebuild the table from the objects themselves
+            if (scanned)
+                reconstruct(*scanned);
+            else
+                reconstruct();
+        }
+    }
+
+    /*
+        Load the xref section at offset, and (if follow_prev is set) every older section
+        reachable through the /Prev chain. Each incremental update to a document appends
+        another section. A section is taken to end by the next section already found
+        after it, or by end (the startxref keyword following the newest section).
+    */
+    void xref_table::get_from(long long offset, bool follow_prev, std::uint64_t end) {
+        vector<xref_section> sections; // newest first
+        std::set<long long> visited;
+        std::set<std::uint64_t> bounds{ end };
+        auto bound = [&](long long start) {
+            auto next = bounds.upper_bound(static_cast<std::uint64_t>(start));
+            return next == bounds.end() ? source.size() : *next;
+        };
+        _reconstructed = false;
+        // a /Prev pointing back into the chain would otherwise loop forever
+        while (visited.insert(offset).second) {
+            auto section = get_section(offset, section_type::table, bound(offset));
+            bounds.insert(static_cast<std::uint64_t>(offset));
+            trailer_dict trailer(section.trailer);
+            if (sections.empty()) {
+                _trailer = section.trailer;
+                _trailer_offset = section.trailer_offset;
+                trailer_storage = section.storage;
+            }
+            // a hybrid file's xref stream supplements the classic section it belongs to
+            if (section.type == section_type::table && trailer.XRefStm() != 0)
+                sections.push_back(get_section(trailer.XRefStm(), section_type::hybrid, bound(trailer.XRefStm())));
+            sections.push_back(section);
+            offset = trailer.Prev();
+            if (offset == 0 || !follow_prev)
+                break;
+        }
+
+        auto size = trailer_dict(_trailer).Size();
+        if (size <= 0)
+            throw pdf_error("xref_table: invalid table size");
+        objects.resize(static_cast<unsigned>(std::min<long long>(size, max_object_id + 1)));
+
+        // apply the oldest section first so newer entries replace older ones
+        auto decoded = decode_sections(sections);
+        for (std::size_t s = decoded.size(); s-- > 0;) {
+            if (sections[s].type == section_type::hybrid) {
+                apply_hybrid(decoded[s], decoded[s + 1]);
+                continue;
+            }
+            for (const auto& subsection : decoded[s])
+                for (unsigned i = 0; i < subsection.entries.size(); ++i)
+                    set_entry(subsection.first + i, subsection.entries[i]);
+        }
+    }
 
+    /*
+        A hybrid file's xref stream only supplies the objects which the classic table
+        of the same update marks free or leaves out, such as those in object streams,
+        which readers that don't know about xref streams never see. Where both have an
+        object in use, the table wins, so all readers agree. The table has already been
+        applied.
+    */
+    void xref_table::apply_hybrid(const vector<xref_subsection>& stream, const vector<xref_subsection>& table) {
+        std::set<unsigned> in_table;
+        for (const auto& subsection : table)
+            for (unsigned i = 0; i < subsection.entries.size(); ++i)
+                if (subsection.entries[i].in_use())
+                    in_table.insert(subsection.first + i);
+        for (const auto& subsection : stream)
+            for (unsigned i = 0; i < subsection.entries.size(); ++i)
+                if (subsection.entries[i].in_use() && in_table.count(subsection.first + i) == 0)
+                    set_entry(subsection.first + i, subsection.entries[i]);
     }
 
-    void xref_table::get_from(int offset) {
-        opt_xref_header header;
-        slice input("");
-        std::tie(header, input) = get_header(this->input.skip(offset));
+    /*
+        Rebuild the table of a damaged file (e.g. one which is truncated, or whose
+        startxref or xref sections are missing or wrong) by scanning it for objects.
+    */
+    void xref_table::reconstruct() {
+        scan_result scan;
+        {
+            // a damaged file has to be scanned in full, but is let go before recovering objects
+            auto whole = source.read(0, static_cast<std::size_t>(std::min<std::uint64_t>(source.size(), SIZE_MAX)));
+            tools::thread_pool pool;
+            scan = scan_objects(whole.data, pool);
+        }
+        reconstruct(scan);
+    }
+
+    /*
+        As above, using a scan of the file which has already been made. Only the objects
+        which might be object streams or the catalog are read.
+    */
+    void xref_table::reconstruct(const scan_result& scan) {
+        if (scan.objects.empty())
+            throw pdf_error("xref_table::reconstruct: no objects found");
+
+        objects.clear();
+        root = objref();
+        _reconstructed = true;
+        // later definitions replace earlier ones, just as incremental updates do
+        vector<std::uint64_t> offsets;
+        for (const auto& object : scan.objects) {
+            set_entry(object.id, xref_entry(object.offset, object.gen, xref_type::in_use));
+            offsets.push_back(object.offset);
+        }
+        recover_objects(offsets);
+        recover_trailer(scan.trailers);
+    }
+
+    /*
+        Find the objects in object streams, and the document catalog, which might be
+        in an object stream too. Objects stored directly in the file take precedence
+        over those in object streams.
+    */
+    void xref_table::recover_objects(const vector<std::uint64_t>& offsets) {
+        tools::atom_table tab;
+        for (std::size_t i = 0; i < offsets.size(); ++i) {
+            if (offsets[i] >= source.size())
+                continue;
+            // only look at the beginning of the object, and not beyond the start of the next
+            auto head = source.read(offsets[i], static_cast<std::size_t>(std::min<std::uint64_t>(
+                i + 1 < offsets.size() ? offsets[i + 1] - offsets[i] : source.size() - offsets[i], 4096)));
+            bool objstm = !head.data.find_first("/ObjStm").empty();
+            if (!objstm && head.data.find_first("/Catalog").empty())
+                continue;
+            try {
+                std::experimental::optional<indirect_object> parsed;
+                auto end = i + 1 < offsets.size() ? offsets[i + 1] : source.size();
+                read_window(source, offsets[i], end, [&](const byte_range& window) {
+                    parser p(window.data, tab);
+                    parsed = p.expect_indirect_object();
+                    parsed->storage = window.storage;
+                    // running into the end of the window means the object may be incomplete
+                    return !p.remainder().empty();
+                });
+                const auto& obj = *parsed;
+                if (!obj.object.is_dict())
+                    continue;
+                pdf_dict dict(obj.object);
+                if (dict.get_name(names::Type) == names::Catalog)
+                    root = obj.ref;
+                if (!objstm || dict.get_name(names::Type) != names::ObjStm)
+                    continue;
+                object_stream stream(obj);
+                for (unsigned index = 0; index < stream.size() && index <= 0xffff; ++index) {
+                    unsigned id = stream.id(index);
+                    // only compressed entries have been added since the scan
+                    if (objects[id].type() == xref_type::in_use)
+                        continue;
+                    set_entry(id, xref_entry(obj.ref.id, index, xref_type::compressed));
+                    auto o = stream.get(index);
+                    if (o.is_dict() && pdf_dict(o).get_name(names::Type) == names::Catalog)
+                        root = objref(id, 0);
+                }
+            } catch (std::runtime_error&) {
+                // skip damaged objects
+            }
+        }
+    }
+
+    /*
+        Use the last intact trailer, if there is one. Otherwise make one up.
+    */
+    void xref_table::recover_trailer(const vector<std::uint64_t>& trailers) {
+        _trailer = variant::make_dict();
+        _trailer_offset = 0;
+        trailer_storage = nullptr;
+        for (auto t = trailers.rbegin(); t != trailers.rend(); ++t) {
+            try {
+                variant dict;
+                std::shared_ptr<const void> storage;
+                // a trailer ends before the next one
+                std::tie(dict, storage) = read_trailer(*t, t == trailers.rbegin() ? source.size() : *(t - 1));
+                if (dict.haskey(names::Root)) {
+                    _trailer = dict;
+                    _trailer_offset = *t;
+                    trailer_storage = storage;
+                    break;
+                }
+            } catch (std::runtime_error&) {
+                // try the previous trailer
+            }
+        }
+        repair_trailer();
+    }
+
+    /*
+        Make sure a reconstructed table's trailer refers to a catalog which exists,
+        and that its /Size covers every object found.
+    */
+    void xref_table::repair_trailer() {
+        auto& dict = _trailer.get_dict();
+        if (root.id != 0 && (!_trailer.haskey(names::Root) || !dict[names::Root].is_ref()
+                             || !(*this)[dict[names::Root].get_ref().id].in_use()))
+            dict[names::Root] = variant::make_ref(root.id, root.gen);
+        dict[names::Size] = variant::make_integer(objects.size());
+    }
+
+    /*
+        Locate the xref section at offset and parse its trailer. The section is either
+        a classic xref table or an xref stream, which is expected to end by end. The entries
+        themselves are decoded later.
+    */
+    auto xref_table::get_section(long long offset, section_type type, std::uint64_t end) const -> xref_section {
+        if (offset < 0 || static_cast<std::uint64_t>(offset) >= source.size())
+            throw format_error("xref_table::get_section: invalid xref offset");
+        xref_section section(type, slice(""), variant());
+        bool stream = false;
+        read_window(source, offset, end, [&](const byte_range& window) {
+            tools::atom_table tab;
+            slice input = window.data;
+            section.storage = window.storage;
+            auto tok = peek_token(input);
+            if (tok && tok->type() == token_type::keyword && tab.find(tok->value()) == keywords::xref) {
+                parser p(input, tab);
+                p.expect_keyword(keywords::xref);
+                slice entries = p.remainder();
+                // entries consist only of digits, n and f, so the first trailer keyword ends the section
+                slice trailer = entries.find_first("trailer");
+                if (trailer.empty())
+                    throw format_error("xref_table::get_section: no trailer");
+                parser t(trailer, tab);
+                t.expect_keyword(keywords::trailer);
+                section.trailer = t.expect_dict();
+                section.entries = slice(entries.begin(), trailer.begin());
+                section.trailer_offset = offset + (trailer.begin() - input.begin());
+                return !t.remainder().empty();
+            }
+
+            parser p(input, tab);
+            auto xref = p.expect_indirect_object();
+            stream = xref.stream && xref.object.is_dict() && xref_stream_dict(xref.object).Type() == names::XRef;
+            section.type = type == section_type::table ? section_type::stream : type;
+            section.trailer = xref.object;
+            section.entries = xref.stream ? *xref.stream : slice("");
+            section.trailer_offset = offset;
+            return !p.remainder().empty();
+        });
+        if (section.type != section_type::table && !stream)
+            throw format_error("xref_table::get_section: not an xref stream");
+        return section;
+    }
+
+    /*
+        Reinstate a table saved by the xref cache. Only the trailer is read from the input.
+    */
+    void xref_table::restore(xref_entries&& entries, std::uint64_t trailer_offset, bool reconstructed, objref catalog) {
+        objects = std::move(entries);
+        _trailer_offset = trailer_offset;
+        _reconstructed = reconstructed;
+        root = catalog;
+        if (reconstructed && trailer_offset == 0) {
+            _trailer = variant::make_dict();
+            trailer_storage = nullptr;
+        } else {
+            std::tie(_trailer, trailer_storage) = read_trailer(trailer_offset, source.size());
+        }
+        if (reconstructed)
+            repair_trailer();
+    }
+
+    /*
+        Parse the trailer dictionary at offset, which is either a trailer keyword
+        followed by a dictionary, or an xref stream object, and is expected to end by end.
+    */
+    auto xref_table::read_trailer(std::uint64_t offset, std::uint64_t end) const
+        -> tuple<variant, std::shared_ptr<const void>> {
+        if (offset >= source.size())
+            throw format_error("xref_table::read_trailer: invalid trailer offset");
+        variant trailer;
+        std::shared_ptr<const void> storage;
+        read_window(source, offset, end, [&](const byte_range& window) {
+            tools::atom_table tab;
+            storage = window.storage;
+            auto tok = peek_token(window.data);
+            parser p(window.data, tab);
+            if (tok && tok->type() == token_type::keyword && tab.find(tok->value()) == keywords::trailer) {
+                p.expect_keyword(keywords::trailer);
+                trailer = p.expect_dict();
+            } else {
+                trailer = p.expect_indirect_object().object;
+            }
+            return !p.remainder().empty();
+        });
+        if (!trailer.is_dict())
+            throw format_error("xref_table::read_trailer: not a trailer");
+        return std::make_tuple(trailer, storage);
+    }
+
+    /*
+        Sections are independent of each other, so documents with many incremental
+        updates have their sections decoded concurrently.
+    */
+    auto xref_table::decode_sections(const vector<xref_section>& sections) const
+        -> vector<vector<xref_subsection>> {
+        vector<vector<xref_subsection>> result(sections.size());
+        auto decode = [&](std::size_t first, std::size_t last) {
+            for (auto i = first; i < last; ++i)
+                result[i] = decode_section(sections[i]);
+        };
+
+        std::size_t threads = std::min<std::size_t>(std::thread::hardware_concurrency(),
+                                                    sections.size() / sections_per_thread);
+        if (threads < 2) {
+            decode(0, sections.size());
+            return result;
+        }
+        vector<std::future<void>> tasks;
+        std::size_t chunk = (sections.size() + threads - 1) / threads;
+        for (std::size_t first = 0; first < sections.size(); first += chunk)
+            tasks.push_back(std::async(std::launch::async, decode,
+                                       first, std::min(first + chunk, sections.size())));
+        for (auto& task : tasks)
+            task.get();
+        return result;
+    }
+
+    auto xref_table::decode_section(const xref_section& section) const -> vector<xref_subsection> {
+        return section.type == section_type::table
+            ? decode_table(section.entries)
+            : decode_xref_stream(section);
+    }
+
+    auto xref_table::decode_table(slice input) const -> vector<xref_subsection> {
+        vector<xref_subsection> result;
+        for (;;) {
+            opt_xref_header header;
+            std::tie(header, input) = get_header(input);
+            if (!header)
+                break;
+            result.emplace_back(header->first);
+            result.back().entries.reserve(header->count);
+            input = get_entries(*header, input.skip_while(iswhitespace), result.back().entries);
+        }
+        return result;
+    }
+
+    /*
+        Each row of an xref stream consists of three big-endian fields whose widths are given by /W.
+        /Index lists the subsections as pairs of first object number and count.
+    */
+    auto xref_table::decode_xref_stream(const xref_section& section) const -> vector<xref_subsection> {
+        xref_stream_dict dict(section.trailer);
+        auto w = dict.W();
+        if (w.size() != 3 || std::any_of(w.begin(), w.end(), [](long long n) { return n < 0 || n > 8; }))
+            throw format_error("xref_table::decode_xref_stream: invalid /W");
+        auto index = dict.Index();
+        if (index.size() % 2 != 0)
+            throw format_error("xref_table::decode_xref_stream: invalid /Index");
+        std::size_t row = w[0] + w[1] + w[2];
+        if (row == 0)
+            throw format_error("xref_table::decode_xref_stream: invalid /W");
+
+        auto data = pdf::decode_stream(section.trailer, section.entries);
+        auto p = reinterpret_cast<const unsigned char*>(data.data());
+        std::size_t rows = data.size() / row;
+        vector<xref_subsection> result;
+        for (std::size_t i = 0; i < index.size(); i += 2) {
+            if (index[i] < 0 || index[i] > max_object_id || index[i + 1] < 0)
+                throw format_error("xref_table::decode_xref_stream: invalid /Index");
+            // a truncated stream yields as many entries as there are complete rows
+            std::size_t count = std::min<std::size_t>(index[i + 1], rows);
+            result.emplace_back(index[i]);
+            result.back().entries.reserve(count);
+            decode_rows(w, p, count, result.back().entries);
+            p += count * row;
+            rows -= count;
+        }
+        return result;
     }
 
     auto xref_table::get_header(slice input) const -> tuple<opt_xref_header, slice> {
@@ -22,12 +570,71 @@ namespace pdf {
         tools::atom_table tab;
         parser p(input, tab);
         try {
-            unsigned first = static_cast<unsigned>(p.expect_integer());
-            unsigned count = static_cast<unsigned>(p.expect_integer());
-            return make_tuple(make_optional(xref_header(first, count)), p.remainder());
+            auto first = p.expect_integer();
+            auto count = p.expect_integer();
+            if (first < 0 || first > max_object_id || count < 0 || count > max_object_id + 1)
+                throw format_error("xref_table::get_header: invalid subsection");
+            return make_tuple(make_optional(xref_header(static_cast<unsigned>(first), static_cast<unsigned>(count))),
+                              p.remainder());
         } catch (format_error&) {
             return make_tuple(opt_xref_header(), p.remainder());
         }
     }
 
+    /*
+        Fast path: well formed entries are decoded at a fixed stride.
+        We fall back to the tokenizer at the first malformed entry.
+    */
+    auto xref_table::get_entries(xref_header header, slice input, vector<xref_entry>& entries) const -> slice {
+        unsigned i = 0;
+        for (; i < header.count && input.length() >= entry_size; ++i) {
+            xref_entry entry;
+            if (!decode_entry(input.begin(), entry))
+                break;
+            entries.push_back(entry);
+            input = input.skip(entry_size);
+        }
+        return i == header.count
+            ? input
+            : parse_entries(xref_header(header.first + i, header.count - i), input, entries);
+    }
+
+    /*
+        Slow path: use the tokenizer to read entries which are not laid out exactly
+        as the spec requires (e.g. single character line endings).
+    */
+    auto xref_table::parse_entries(xref_header header, slice input, vector<xref_entry>& entries) const -> slice {
+        tools::atom_table tab;
+        parser p(input, tab);
+        for (unsigned i = 0; i < header.count; ++i) {
+            auto offset = p.expect_integer();
+            auto gen = p.expect_integer();
+            auto type = p.next_object();
+            if (offset < 0 || static_cast<std::uint64_t>(offset) > xref_entry::max_offset || gen < 0 || gen > 0xffff)
+                throw format_error("xref_table::parse_entries: invalid entry");
+            if (!type || !type->is_keyword())
+                throw format_error("xref_table::parse_entries: missing entry type");
+            switch (type->get_keyword()) {
+                case keywords::n:
+                    entries.push_back(xref_entry(offset, static_cast<unsigned short>(gen), xref_type::in_use));
+                    break;
+                case keywords::f:
+                    entries.push_back(xref_entry(offset, static_cast<unsigned short>(gen), xref_type::free));
+                    break;
+                default:
+                    throw format_error("xref_table::parse_entries: invalid entry type");
+            }
+        }
+        return p.remainder();
+    }
+
+    /*
+        /Size is frequently wrong, so the table grows as needed.
+    */
+    void xref_table::set_entry(unsigned id, xref_entry entry) {
+        if (id > max_object_id)
+            throw format_error("xref_table::set_entry: invalid object number");
+        objects.set(id, entry);
+    }
+
 }
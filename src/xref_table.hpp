@@ -1,16 +1,23 @@
 #ifndef XREF_TABLE_HPP
 #define XREF_TABLE_HPP
 
+#include <algorithm>
+#include <cstdint>
 #include <experimental/optional>
+#include <memory>
+#include <stdexcept>
 #include <tuple>
 #include <vector>
 
+#include "byte_source.hpp"
 #include "tools.hpp"
+#include "xref_scanner.hpp"
 
 namespace pdf {
 
     using std::tuple;
     using std::vector;
+    using tools::objref;
     using tools::slice;
     using tools::variant;
 
@@ -22,34 +29,210 @@ namespace pdf {
 
     using opt_xref_header = std::experimental::optional<xref_header>;
 
+    enum class xref_type : unsigned char {
+        free, in_use,
+        compressed // stored in an object stream
+    };
+
+    /*
+        An xref entry packed into 64 bits: a 40 bit offset, a 16 bit generation
+        and the entry type. For compressed entries, the offset and gen fields hold
+        the object number of the object stream and the index of the object within it.
+    */
     class xref_entry {
     public:
-        xref_entry(unsigned offset = 0, unsigned short gen = 0xffff) : _offset(offset), _gen(gen) {}
+        static const std::uint64_t max_offset = (std::uint64_t(1) << 40) - 1;
+
+        xref_entry(std::uint64_t offset = 0, unsigned short gen = 0xffff, xref_type type = xref_type::free)
+            : bits((offset & max_offset) | std::uint64_t(gen) << 40 | std::uint64_t(type) << 56) {}
+
+        auto offset() const noexcept -> std::uint64_t { return bits & max_offset; }
+        auto gen() const noexcept -> unsigned short { return static_cast<unsigned short>(bits >> 40); }
+        auto type() const noexcept -> xref_type { return static_cast<xref_type>(bits >> 56); }
+        auto in_use() const noexcept -> bool { return type() != xref_type::free; }
+
+        auto stream() const noexcept -> unsigned { return static_cast<unsigned>(offset()); }
+        auto index() const noexcept -> unsigned short { return gen(); }
 
-        auto offset() const noexcept -> unsigned { return _offset; }
-        auto gen() const noexcept -> unsigned short { return _gen; }
+        // the packed representation, as stored in the xref cache
+        auto raw() const noexcept -> std::uint64_t { return bits; }
+        static auto from_raw(std::uint64_t bits) noexcept -> xref_entry {
+            xref_entry entry;
+            entry.bits = bits;
+            return entry;
+        }
 
     private:
-        unsigned _offset;
-        unsigned short _gen;
+        std::uint64_t bits;
+    };
+
+    /*
+        Sparse storage for xref entries. Entries live in fixed size pages which are
+        only allocated once an entry in them is set, so a huge but sparsely used
+        /Size doesn't cost anything. Pages can also be borrowed from memory owned by
+        someone else, such as a mapping of the xref cache, which is only copied if
+        an entry in it is set.
+    */
+    class xref_entries {
+    public:
+        static const unsigned page_bits = 10;
+        static const unsigned page_size = 1 << page_bits;
+
+        auto size() const noexcept -> unsigned { return _size; }
+
+        // entries which have never been set are free
+        auto operator[](unsigned id) const noexcept -> xref_entry {
+            if (id >= _size || !pages[id >> page_bits])
+                return xref_entry();
+            return pages[id >> page_bits][id & page_mask];
+        }
+
+        void set(unsigned id, xref_entry entry) {
+            if (id >= _size)
+                resize(id + 1);
+            auto n = id >> page_bits;
+            if (!owned[n]) {
+                owned[n].reset(new xref_entry[page_size]);
+                if (pages[n])
+                    std::copy(pages[n], pages[n] + page_size, owned[n].get());
+                pages[n] = owned[n].get();
+                ++allocated;
+            }
+            owned[n][id & page_mask] = entry;
+        }
+
+        void resize(unsigned size) {
+            _size = size;
+            pages.resize((size + page_size - 1) >> page_bits);
+            owned.resize(pages.size());
+        }
+
+        void clear() {
+            pages.clear();
+            owned.clear();
+            storage.clear();
+            _size = 0;
+            allocated = 0;
+        }
+
+        auto page_count() const noexcept -> unsigned { return pages.size(); }
+
+        // page_size entries, or nullptr if no entry in the page has been set
+        auto page(unsigned n) const noexcept -> const xref_entry* { return pages[n]; }
+
+        // use the page_size entries at entries, which stay valid as long as memory is kept
+        void borrow_page(unsigned n, const xref_entry* entries, std::shared_ptr<const void> memory) {
+            if (n >= pages.size())
+                throw std::out_of_range("xref_entries::borrow_page");
+            if (owned[n]) {
+                owned[n] = nullptr;
+                --allocated;
+            }
+            pages[n] = entries;
+            if (storage.empty() || storage.back() != memory)
+                storage.push_back(std::move(memory));
+        }
+
+        // approximate heap usage, for benchmarking
+        auto memory() const noexcept -> std::size_t {
+            return pages.capacity() * (sizeof(pages[0]) + sizeof(owned[0])) + allocated * page_size * sizeof(xref_entry);
+        }
+
+    private:
+        static const unsigned page_mask = page_size - 1;
+
+        vector<const xref_entry*> pages;
+        vector<std::unique_ptr<xref_entry[]>> owned; // the pages which aren't borrowed
+        vector<std::shared_ptr<const void>> storage; // of the borrowed pages
+        unsigned _size = 0;
+        std::size_t allocated = 0;
+    };
+
+    /*
+        A run of consecutively numbered entries from one xref section.
+    */
+    struct xref_subsection {
+        xref_subsection(unsigned first) : first(first) {}
+        unsigned first;
+        vector<xref_entry> entries;
+    };
+
+    enum class section_type {
+        table,  // classic xref table
+        stream, // xref stream (PDF 1.5)
+        hybrid  // xref stream referenced by the /XRefStm entry of a classic trailer
+    };
+
+    /*
+        An xref section located in the input, but not yet decoded.
+    */
+    struct xref_section {
+        xref_section(section_type type, slice entries, const variant& trailer)
+            : type(type), entries(entries), trailer(trailer) {}
+        section_type type;
+        slice entries; // everything between the xref and trailer keywords, or the raw stream data
+        variant trailer; // the trailer or xref stream dictionary
+        std::uint64_t trailer_offset = 0; // of the trailer keyword, or of the xref stream object
+        std::shared_ptr<const void> storage; // keeps entries and trailer valid
     };
 
     class xref_table {
     public:
-        xref_table(slice input, int size) : input(input) {
-            if (size <= 0)
-                throw pdf_error("xref_table: invalid table size");
-            objects.resize(size + 1);
+        xref_table(const byte_source& source) : source(source) {}
+        xref_table(slice input) : owned(new memory_source(input)), source(*owned) {}
+
+        // find the xref sections through startxref, or reconstruct the table if that fails
+        void load(const scan_result* scanned = nullptr);
+
+        void get_from(long long offset, bool follow_prev = true, std::uint64_t end = UINT64_MAX);
+        void reconstruct();
+        void reconstruct(const scan_result& scan);
+
+        auto size() const noexcept -> unsigned { return objects.size(); }
+        auto memory() const noexcept -> std::size_t { return objects.memory(); }
+
+        auto operator[](unsigned id) const noexcept -> xref_entry {
+            return objects[id];
         }
 
-        void get_previous(int offset);
-        void get_from(int offset);
+        // the trailer dictionary of the most recent xref section
+        auto trailer() const noexcept -> const variant& { return _trailer; }
+
+        /*
+            What the xref cache needs to save and restore a table: the entries, where the
+            trailer was read from (0 if it was made up), and whether the table was
+            reconstructed, in which case the trailer was repaired using the catalog found.
+        */
+        auto entries() const noexcept -> const xref_entries& { return objects; }
+        auto trailer_offset() const noexcept -> std::uint64_t { return _trailer_offset; }
+        auto reconstructed() const noexcept -> bool { return _reconstructed; }
+        auto catalog() const noexcept -> objref { return root; }
+        void restore(xref_entries&& entries, std::uint64_t trailer_offset, bool reconstructed, objref catalog);
 
     private:
-        const slice input; // entire pdf file
-        vector<xref_entry> objects;
+        std::unique_ptr<byte_source> owned; // when constructed from a slice
+        const byte_source& source; // entire pdf file
+        xref_entries objects;
+        variant _trailer;
+        std::shared_ptr<const void> trailer_storage; // keeps the strings in the trailer valid
+        std::uint64_t _trailer_offset = 0;
+        bool _reconstructed = false;
+        objref root; // the catalog found while reconstructing
 
+        auto get_section(long long offset, section_type type, std::uint64_t end) const -> xref_section;
+        auto decode_sections(const vector<xref_section>& sections) const -> vector<vector<xref_subsection>>;
+        auto decode_section(const xref_section& section) const -> vector<xref_subsection>;
+        auto decode_table(slice input) const -> vector<xref_subsection>;
+        auto decode_xref_stream(const xref_section& section) const -> vector<xref_subsection>;
         auto get_header(slice input) const -> tuple<opt_xref_header, slice>;
+        auto get_entries(xref_header header, slice input, vector<xref_entry>& entries) const -> slice;
+        auto parse_entries(xref_header header, slice input, vector<xref_entry>& entries) const -> slice;
+        void set_entry(unsigned id, xref_entry entry);
+        void apply_hybrid(const vector<xref_subsection>& stream, const vector<xref_subsection>& table);
+        void recover_objects(const vector<std::uint64_t>& offsets);
+        void recover_trailer(const vector<std::uint64_t>& trailers);
+        void repair_trailer();
+        auto read_trailer(std::uint64_t offset, std::uint64_t end) const -> tuple<variant, std::shared_ptr<const void>>;
     };
 
 }
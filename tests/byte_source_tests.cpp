@@ -0,0 +1,222 @@
+#include "catch.hpp"
+#include "byte_source.hpp"
+#include "object_loader.hpp"
+#include "pdfp.hpp"
+#include "pipe_source.hpp"
+#include "xref_table.hpp"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+
+using pdf::byte_extent;
+using pdf::byte_range;
+using pdf::file_source;
+using pdf::memory_source;
+using pdf::pipe_source;
+using pdf::tools::slice;
+
+namespace {
+
+    const std::string filename = std::string(P_tmpdir) + "/pdfp_byte_source_tests.pdf";
+
+    void write_file(const std::string& contents) {
+        std::ofstream file(filename, std::ios::binary);
+        file.write(contents.data(), contents.size());
+    }
+
+    /*
+        A pdf with a stream and an xref table which are both larger than the
+        initial window used to read them.
+    */
+    auto large_pdf() -> std::string {
+        std::string pdf = "%PDF-1.4\n";
+        std::vector<std::size_t> offsets;
+        offsets.push_back(pdf.size());
+        pdf += "1 0 obj\n<</Length 1000000>>\nstream\n" + std::string(1000000, 'x') + "\nendstream\nendobj\n";
+        for (int i = 2; i < 5000; ++i) {
+            offsets.push_back(pdf.size());
+            pdf += std::to_string(i) + " 0 obj\n(object " + std::to_string(i) + ")\nendobj\n";
+        }
+        auto xref = pdf.size();
+        pdf += "xref\n0 5000\n0000000000 65535 f\r\n";
+        char entry[21];
+        for (auto offset : offsets) {
+            snprintf(entry, sizeof entry, "%010zu 00000 n\r\n", offset);
+            pdf += entry;
+        }
+        pdf += "trailer\n<</Size 5000>>\nstartxref\n" + std::to_string(xref) + "\n%%EOF\n";
+        return pdf;
+    }
+
+    /*
+        A pipe_source reading contents, which are written to the pipe in small parts
+        by another thread.
+    */
+    auto through_pipe(const std::string& contents, std::size_t memory_limit) -> std::unique_ptr<pipe_source> {
+        int fds[2];
+        REQUIRE(pipe(fds) == 0);
+        std::thread writer([&] {
+            for (std::size_t offset = 0; offset < contents.size(); offset += 1000)
+                write(fds[1], contents.data() + offset, std::min<std::size_t>(1000, contents.size() - offset));
+            close(fds[1]);
+        });
+        auto source = std::make_unique<pipe_source>(fds[0], memory_limit);
+        writer.join();
+        close(fds[0]);
+        return source;
+    }
+
+}
+
+TEST_CASE("memory_source: read", "[byte_source]") {
+    memory_source source(slice("0123456789"));
+    CHECK(source.size() == 10);
+    CHECK(source.read(0, 4).data == "0123");
+    CHECK(source.read(8, 4).data == "89");
+    CHECK(source.read(10, 4).data.empty());
+    CHECK(source.read(100, 4).data.empty());
+}
+
+TEST_CASE("file_source: read", "[byte_source]") {
+    write_file("0123456789abcdefghij");
+    // tiny pages, so reads span several pages and pages are evicted
+    file_source source(filename, 4, 2);
+    CHECK(source.size() == 20);
+    CHECK(source.read(1, 2).data == "12");
+    CHECK(source.bytes_read() == 4);
+    CHECK(source.read(0, 4).data == "0123");
+    CHECK(source.bytes_read() == 4);
+    byte_range range = source.read(2, 11);
+    CHECK(range.data == "23456789abc");
+    auto page = source.read(17, 2);
+    // evicting pages doesn't invalidate ranges
+    source.read(0, 20);
+    CHECK(range.data == "23456789abc");
+    CHECK(page.data == "hi");
+    CHECK(source.read(18, 10).data == "ij");
+    CHECK(source.read(20, 10).data.empty());
+    std::remove(filename.c_str());
+    CHECK_THROWS(file_source(filename).size());
+}
+
+TEST_CASE("file_source: objects larger than the initial window", "[byte_source]") {
+    auto pdf = large_pdf();
+    write_file(pdf);
+    file_source source(filename, 4096, 16);
+    pdf::xref_table xref(source);
+    xref.get_from(std::stoll(pdf.substr(pdf.rfind("startxref") + 10)));
+    CHECK(xref.size() == 5000);
+    CHECK(xref[4999].in_use());
+    pdf::object_loader objects(source, xref);
+    auto stream = objects.get(pdf::tools::objref(1, 0));
+    REQUIRE(stream.stream);
+    CHECK(stream.stream->length() == 1000000);
+    CHECK(objects.get(pdf::tools::objref(4999, 0)).object.get_string() == "(object 4999)");
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("file_source: open reads only what it needs", "[byte_source]") {
+    auto pdf = large_pdf();
+    write_file(pdf);
+    auto source = std::make_unique<file_source>(filename, 4096, 16);
+    auto s = source.get();
+    auto parser = pdf::make_pdf_parser(std::move(source));
+    // the tail, and the xref table which is about 100 KB
+    CHECK(s->bytes_read() < 256 * 1024);
+    CHECK(s->bytes_read() < pdf.size() / 2);
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("file_source: prefetch", "[byte_source]") {
+    std::string contents;
+    for (int i = 0; i < 1000; ++i)
+        contents += std::to_string(i % 10);
+    write_file(contents);
+    for (bool use_io_uring : { true, false }) {
+        file_source source(filename, 16, 100, use_io_uring);
+        source.prefetch({ byte_extent(0, 100), byte_extent(480, 40), byte_extent(990, 100) });
+        CHECK(source.read(0, 100).data == slice(contents.data(), 100));
+        CHECK(source.read(485, 30).data == slice(contents.data() + 485, 30));
+        CHECK(source.read(990, 10).data == slice(contents.data() + 990, 10));
+        // pages 0-6, 30-32 and 61-62, read once each
+        CHECK(source.bytes_read() == 7 * 16 + 3 * 16 + 16 + 8);
+        // no more than fit in the cache
+        source.prefetch({ byte_extent(0, 1000) });
+        CHECK(source.read(0, 1000).data == slice(contents.data(), 1000));
+        CHECK(source.bytes_read() <= 1000 + 100 * 16);
+    }
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("object_loader: prefetch", "[byte_source]") {
+    auto pdf = large_pdf();
+    write_file(pdf);
+    file_source source(filename, 4096, 1024);
+    pdf::xref_table xref(source);
+    xref.get_from(std::stoll(pdf.substr(pdf.rfind("startxref") + 10)));
+    pdf::object_loader objects(source, xref);
+    std::vector<pdf::tools::objref> refs;
+    for (int id = 4999; id > 0; --id)
+        refs.push_back(pdf::tools::objref(id, 0));
+    objects.prefetch(refs);
+    int loaded = 0;
+    for (auto ref : refs)
+        loaded += objects.get(ref).ref.id == ref.id;
+    CHECK(loaded == 4999);
+    // everything was prefetched, and each page was only read once
+    CHECK(source.bytes_read() <= pdf.size());
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("object_loader: get_all from a file", "[byte_source]") {
+    auto pdf = large_pdf();
+    write_file(pdf);
+    file_source source(filename, 4096, 16);
+    pdf::xref_table xref(source);
+    xref.get_from(std::stoll(pdf.substr(pdf.rfind("startxref") + 10)));
+    auto before = source.bytes_read();
+    pdf::object_loader objects(source, xref);
+    std::vector<pdf::tools::objref> refs;
+    for (int id = 4999; id > 0; --id)
+        refs.push_back(pdf::tools::objref(id, 0));
+    auto all = objects.get_all(refs);
+    REQUIRE(all.size() == refs.size());
+    CHECK(all[0].object.get_string() == "(object 4999)");
+    CHECK(all.back().stream->length() == 1000000);
+    // the objects are read in a single pass, even though they don't fit in the cache
+    CHECK(source.bytes_read() <= before + pdf.size());
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("pipe_source: read", "[byte_source]") {
+    auto pdf = large_pdf();
+    for (std::size_t memory_limit : { std::size_t(1) << 30, std::size_t(100000) }) {
+        auto source = through_pipe(pdf, memory_limit);
+        CHECK(source->spilled() == (memory_limit < pdf.size()));
+        CHECK(source->size() == pdf.size());
+        CHECK(source->read(0, pdf.size()).data == slice(pdf.data(), pdf.size()));
+        CHECK(source->read(pdf.size() - 10, 100).data == slice(pdf.data() + pdf.size() - 10, 10));
+        CHECK(source->read(pdf.size(), 100).data.empty());
+        CHECK(source->objects().objects.size() == 4999);
+        CHECK(source->objects().trailers.size() == 1);
+        CHECK_NOTHROW(pdf::make_pdf_parser(std::move(source)));
+    }
+    CHECK(through_pipe("", 0)->size() == 0);
+}
+
+TEST_CASE("pipe_source: damaged file", "[byte_source]") {
+    // without its xref table, the table is rebuilt from the objects found while reading
+    auto pdf = large_pdf();
+    pdf.resize(pdf.find("xref\n"));
+    auto source = through_pipe(pdf, 1 << 20);
+    pdf::xref_table xref(*source);
+    xref.reconstruct(source->objects());
+    CHECK(xref.size() == 5000);
+    CHECK(xref[4999].offset() == pdf.rfind("4999 0 obj"));
+    CHECK_NOTHROW(pdf::make_pdf_parser(std::move(source)));
+}
@@ -0,0 +1,153 @@
+#include "catch.hpp"
+#include "test_tools.hpp"
+#include "filter_pipeline.hpp"
+#include "parser.hpp"
+#include "tools/ring_buffer.hpp"
+
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+using pdf::filter_pipeline;
+using pdf::tools::slice;
+
+namespace {
+
+    auto compress_string(const std::string& s) -> std::string {
+        std::string result(compressBound(s.size()), '\0');
+        uLongf length = result.size();
+        compress(reinterpret_cast<Bytef*>(&result[0]), &length, reinterpret_cast<const Bytef*>(s.data()), s.size());
+        result.resize(length);
+        return result;
+    }
+
+    auto hex_encode(const std::string& data) -> std::string {
+        std::string out;
+        for (std::size_t i = 0; i < data.size(); ++i) {
+            out += "0123456789abcdef"[static_cast<unsigned char>(data[i]) >> 4];
+            out += "0123456789abcdef"[data[i] & 0xf];
+            if (i % 40 == 39)
+                out += '\n';
+        }
+        return out + ">";
+    }
+
+    auto content() -> std::string {
+        std::string text;
+        for (int i = 0; i < 5000; ++i)
+            text += "BT /F1 12 Tf 72 " + std::to_string(i % 700) + " Td (" + std::to_string(i) + ") Tj ET\n";
+        return text;
+    }
+
+    // read all of a pipeline in parts of the given size
+    auto read_all(filter_pipeline& pipeline, std::size_t part) -> std::string {
+        std::string out;
+        std::vector<char> buffer(part);
+        while (!pipeline.done()) {
+            auto n = pipeline.read(buffer.data(), buffer.size());
+            out.append(buffer.data(), n);
+            if (n < part && !pipeline.done())
+                return out + "<short read before the end>";
+        }
+        return out;
+    }
+
+}
+
+TEST_CASE("ring_buffer: wrap around", "[filter_pipeline]") {
+    pdf::tools::ring_buffer ring(8);
+    CHECK(ring.empty());
+    auto back = ring.back();
+    CHECK(back.second == 8);
+    std::copy_n("abcdef", 6, back.first);
+    ring.commit(6);
+    CHECK(ring.front() == "abcdef");
+    ring.consume(4);
+    CHECK(ring.front() == "ef");
+
+    // the free space runs to the end of the memory first, and then wraps
+    back = ring.back();
+    CHECK(back.second == 2);
+    std::copy_n("gh", 2, back.first);
+    ring.commit(2);
+    back = ring.back();
+    CHECK(back.second == 4);
+    std::copy_n("ijkl", 4, back.first);
+    ring.commit(4);
+    CHECK(ring.full());
+    CHECK(ring.back().second == 0);
+    CHECK(ring.front() == "efgh");
+    ring.consume(4);
+    CHECK(ring.front() == "ijkl");
+    ring.consume(4);
+    CHECK(ring.empty());
+    CHECK(ring.back().second == 8);
+}
+
+TEST_CASE("filter_pipeline: filter arrays", "[filter_pipeline]") {
+    pdf::atom_table t;
+    auto text = content();
+    auto encoded = hex_encode(compress_string(text));
+    auto dict = *pdf::parser("<</Filter [/ASCIIHexDecode /FlateDecode]>>", t).next_object();
+    for (std::size_t buffer_size : { 1, 7, 1 << 16 }) {
+        for (std::size_t part : { 1, 100, 1 << 20 }) {
+            filter_pipeline pipeline(dict, to_slice(encoded), buffer_size);
+            CHECK(pipeline.stages() == 2);
+            INFO(buffer_size << " byte buffers, " << part << " byte reads");
+            CHECK(read_all(pipeline, part) == text);
+        }
+    }
+
+    // the start is available long before the whole stream is decoded
+    filter_pipeline pipeline(dict, to_slice(encoded), 1024);
+    char start[10];
+    CHECK(pipeline.read(start, sizeof start) == sizeof start);
+    CHECK(std::string(start, sizeof start) == text.substr(0, sizeof start));
+    CHECK(!pipeline.done());
+
+    auto none = *pdf::parser("<</Length 5>>", t).next_object();
+    filter_pipeline plain(none, "hello");
+    CHECK(plain.stages() == 0);
+    CHECK(read_all(plain, 2) == "hello");
+}
+
+TEST_CASE("filter_pipeline: predictors", "[filter_pipeline]") {
+    pdf::atom_table t;
+    // 4 columns of 8 bit RGB, in rows with every PNG filter type
+    std::string rows;
+    for (int r = 0; r < 50; ++r) {
+        rows += static_cast<char>(r % 5);
+        for (int i = 0; i < 12; ++i)
+            rows += static_cast<char>(r * 31 + i * 7);
+    }
+    auto png = *pdf::parser("<</Filter /FlateDecode /DecodeParms <</Predictor 15 /Colors 3 /Columns 4>>>>", t).next_object();
+    auto expected = pdf::png_predictor(to_slice(rows), 3, 8, 4);
+    auto compressed = compress_string(rows + "\x02\x01");
+    for (std::size_t buffer_size : { 5, 1 << 16 }) {
+        filter_pipeline pipeline(png, to_slice(compressed), buffer_size);
+        CHECK(pipeline.stages() == 2);
+        CHECK(read_all(pipeline, 7) == std::string(expected.begin(), expected.end()));
+    }
+
+    auto tiff = *pdf::parser("<</Filter [/FlateDecode] /DecodeParms [<</Predictor 2 /Columns 5>>]>>", t).next_object();
+    compressed = compress_string(std::string("\x01\x01\x01\x01\x01\x0a\x01\x01\x01\x01\x05\x05", 12));
+    filter_pipeline pipeline(tiff, to_slice(compressed));
+    CHECK(read_all(pipeline, 3) == std::string("\x01\x02\x03\x04\x05\x0a\x0b\x0c\x0d\x0e\x05\x05", 12));
+
+    auto unsupported = *pdf::parser("<</Filter /FlateDecode /DecodeParms <</Predictor 3>>>>", t).next_object();
+    CHECK_THROWS(filter_pipeline(unsupported, "x"));
+}
+
+TEST_CASE("filter_pipeline: hostile predictor parameters", "[filter_pipeline]") {
+    pdf::atom_table t;
+    auto compressed = compress_string("some data");
+    // rows of 8 * 2^29 bits used to wrap round to nothing, and decoding never ended
+    for (auto parms : { "<</Predictor 2 /Columns 536870912>>", "<</Predictor 12 /Columns 536870912>>",
+                        "<</Predictor 12 /Colors 65536 /BitsPerComponent 16 /Columns 65536>>" }) {
+        INFO(parms);
+        auto text = std::string("<</Filter /FlateDecode /DecodeParms ") + parms + ">>";
+        auto dict = *pdf::parser(to_slice(text), t).next_object();
+        CHECK_THROWS(filter_pipeline(dict, to_slice(compressed)));
+        CHECK_THROWS(pdf::decode_stream(dict, to_slice(compressed)));
+    }
+}
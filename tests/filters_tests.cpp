@@ -0,0 +1,494 @@
+#include "catch.hpp"
+#include "test_tools.hpp"
+#include "tools.hpp"
+#include "filters.hpp"
+#include "parser.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <zlib.h>
+
+using pdf::tools::slice;
+
+namespace {
+
+    auto compress_string(const std::string& s) -> std::string {
+        std::string result(compressBound(s.size()), '\0');
+        uLongf length = result.size();
+        compress(reinterpret_cast<Bytef*>(&result[0]), &length, reinterpret_cast<const Bytef*>(s.data()), s.size());
+        result.resize(length);
+        return result;
+    }
+
+    auto to_string(const std::vector<char>& v) -> std::string {
+        return std::string(v.begin(), v.end());
+    }
+
+    /*
+        PNG un-filtering straight from the specification, one byte at a time.
+    */
+    auto png_reference(const std::string& data, std::size_t bpp, std::size_t row) -> std::vector<char> {
+        std::vector<int> out;
+        for (std::size_t r = 0; r < data.size() / (row + 1); ++r) {
+            auto type = data[r * (row + 1)];
+            for (std::size_t i = 0; i < row; ++i) {
+                int x = static_cast<unsigned char>(data[r * (row + 1) + 1 + i]);
+                int a = i < bpp ? 0 : out[out.size() - bpp];
+                int b = r == 0 ? 0 : out[out.size() - row];
+                int c = r == 0 || i < bpp ? 0 : out[out.size() - row - bpp];
+                int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+                int predictor[] = { 0, a, b, (a + b) / 2, pa <= pb && pa <= pc ? a : pb <= pc ? b : c };
+                out.push_back((x + predictor[static_cast<int>(type)]) & 0xff);
+            }
+        }
+        return std::vector<char>(out.begin(), out.end());
+    }
+
+    /*
+        An LZW encoder, which clears the table when it is full. The code width follows
+        the decoder's table, which lags one entry behind the encoder's.
+    */
+    auto lzw_encode(const std::string& data, int early_change) -> std::string {
+        std::string out;
+        std::uint64_t bits = 0;
+        int count = 0, width = 9;
+        auto put = [&](unsigned code) {
+            bits = (bits << width) | code;
+            for (count += width; count >= 8; count -= 8)
+                out += static_cast<char>(bits >> (count - 8));
+        };
+        std::unordered_map<unsigned, unsigned> table;
+        unsigned next = 258, decoder_next = 258;
+        bool first = true;
+        auto emit = [&](unsigned code) {
+            put(code);
+            if (!first && ++decoder_next + early_change >= (1u << width) && width < 12)
+                ++width;
+            first = false;
+        };
+        put(256);
+        int w = -1;
+        for (char ch : data) {
+            unsigned c = static_cast<unsigned char>(ch);
+            if (w < 0) {
+                w = c;
+                continue;
+            }
+            auto found = table.find(w << 8 | c);
+            if (found != table.end()) {
+                w = found->second;
+                continue;
+            }
+            emit(w);
+            table[w << 8 | c] = next++;
+            if (next == 4095) {
+                put(256);
+                table.clear();
+                next = decoder_next = 258;
+                width = 9;
+                first = true;
+            }
+            w = c;
+        }
+        if (w >= 0)
+            emit(w);
+        put(257);
+        if (count > 0)
+            out += static_cast<char>(bits << (8 - count));
+        return out;
+    }
+
+    auto hex_encode(const std::string& data, std::size_t line) -> std::string {
+        std::string out;
+        for (std::size_t i = 0; i < data.size(); ++i) {
+            out += "0123456789abcdef"[static_cast<unsigned char>(data[i]) >> 4];
+            out += "0123456789ABCDEF"[data[i] & 0xf];
+            if ((i + 1) % line == 0)
+                out += '\n';
+        }
+        return out + ">";
+    }
+
+    auto a85_encode(const std::string& data, std::size_t line) -> std::string {
+        std::string out;
+        for (std::size_t i = 0; i < data.size(); i += 4) {
+            std::uint32_t value = 0;
+            std::size_t n = std::min<std::size_t>(4, data.size() - i);
+            for (std::size_t j = 0; j < 4; ++j)
+                value = value << 8 | (j < n ? static_cast<unsigned char>(data[i + j]) : 0);
+            if (value == 0 && n == 4) {
+                out += 'z';
+            } else {
+                char group[5];
+                for (int j = 4; j >= 0; --j, value /= 85)
+                    group[j] = static_cast<char>('!' + value % 85);
+                out.append(group, n + 1);
+            }
+            if ((i / 4 + 1) % line == 0)
+                out += '\n';
+        }
+        return out + "~>";
+    }
+
+    // packs rows of samples of bpc bits, each row starting on a byte boundary
+    auto pack_samples(const std::vector<unsigned>& samples, std::size_t per_row, int bpc) -> std::vector<char> {
+        std::vector<char> out;
+        for (std::size_t r = 0; r < samples.size() / per_row; ++r) {
+            std::size_t start = out.size();
+            out.resize(start + (per_row * bpc + 7) / 8);
+            for (std::size_t n = 0; n < per_row; ++n)
+                for (int bit = 0; bit < bpc; ++bit)
+                    if (samples[r * per_row + n] >> (bpc - 1 - bit) & 1)
+                        out[start + (n * bpc + bit) / 8] |= static_cast<char>(0x80 >> ((n * bpc + bit) % 8));
+        }
+        return out;
+    }
+
+}
+
+TEST_CASE("flate_decode: round trip", "[filters]") {
+    std::string text;
+    for (int i = 0; i < 10000; ++i)
+        text += "BT /F1 12 Tf (" + std::to_string(i) + ") Tj ET\n";
+    auto decoded = pdf::flate_decode(to_slice(compress_string(text)));
+    CHECK(to_string(decoded) == text);
+    CHECK(pdf::flate_decode(to_slice(compress_string(""))).empty());
+}
+
+TEST_CASE("flate_decode: damaged data", "[filters]") {
+    std::string text(50000, 'x');
+    for (std::size_t i = 0; i < text.size(); i += 7)
+        text[i] = static_cast<char>('a' + i % 26);
+    auto compressed = compress_string(text);
+    auto truncated = pdf::flate_decode(to_slice(compressed.substr(0, compressed.size() / 2)));
+    CHECK(!truncated.empty());
+    CHECK(to_string(truncated) == text.substr(0, truncated.size()));
+    CHECK_THROWS(pdf::flate_decode("this is not zlib data"));
+}
+
+TEST_CASE("png_predictor: filter types", "[filters]") {
+    std::string predicted(
+        "\x01\x01\x02\x03"  // Sub
+        "\x02\x01\x01\x01"  // Up
+        "\x03\x00\x00\x00"  // Average
+        "\x04\x00\x00\x00"  // Paeth
+        "\x00\x09\x09\x09", // None
+        20);
+    auto decoded = pdf::png_predictor(to_slice(predicted), 1, 8, 3);
+    CHECK(decoded == std::vector<char>({ 1, 3, 6, 2, 4, 7, 1, 2, 4, 1, 2, 4, 9, 9, 9 }));
+    CHECK_THROWS(pdf::png_predictor(to_slice(std::string("\x05\x00\x00\x00", 4)), 1, 8, 3));
+    CHECK_THROWS(pdf::png_predictor(to_slice(predicted), 0, 8, 3));
+}
+
+TEST_CASE("png_predictor: pixel sizes", "[filters]") {
+    // all filter types, on rows which are not a multiple of the vector width
+    for (int colors : { 1, 2, 3, 4, 5, 6, 8 }) {
+        for (int columns : { 1, 5, 37 }) {
+            std::size_t row = colors * columns;
+            std::string data;
+            for (int r = 0; r < 20; ++r) {
+                data += static_cast<char>(r % 5);
+                for (std::size_t i = 0; i < row; ++i)
+                    data += static_cast<char>((r * 131 + i * 2654435761u) >> 7);
+            }
+            INFO(colors << " colors, " << columns << " columns");
+            CHECK(pdf::png_predictor(to_slice(data), colors, 8, columns) == png_reference(data, colors, row));
+        }
+    }
+    // 16 bit samples
+    std::string data;
+    for (int r = 0; r < 10; ++r) {
+        data += static_cast<char>(r % 5);
+        for (int i = 0; i < 3 * 2 * 9; ++i)
+            data += static_cast<char>(r * 7 + i * 13);
+    }
+    CHECK(pdf::png_predictor(to_slice(data), 3, 16, 9) == png_reference(data, 6, 54));
+
+    // 12 bit pixels take 2 bytes for the filters, as in other readers
+    data.clear();
+    for (int r = 0; r < 10; ++r) {
+        data += static_cast<char>(r % 5);
+        for (int i = 0; i < 15; ++i)
+            data += static_cast<char>(r * 7 + i * 13);
+    }
+    CHECK(pdf::png_predictor(to_slice(data), 3, 4, 10) == png_reference(data, 2, 15));
+}
+
+TEST_CASE("decode_stream: predictor parameters beyond 32 bits", "[filters]") {
+    using namespace pdf;
+    atom_table t;
+    // /Columns 2^32 + 1 must not be read as 1
+    auto dict = *parser("<</Filter /FlateDecode /DecodeParms <</Predictor 12 /Columns 4294967297>>>>", t).next_object();
+    auto compressed = compress_string(std::string("\x00\x01\x00\x02", 4));
+    CHECK_THROWS(decode_stream(dict, to_slice(compressed)));
+    auto wide = *parser("<</Filter /FlateDecode /DecodeParms <</Predictor 2 /Colors 4294967297>>>>", t).next_object();
+    CHECK_THROWS(decode_stream(wide, to_slice(compressed)));
+    // the fallback to reconstructing a damaged file relies on these being runtime errors
+    CHECK_THROWS_AS(png_predictor("abc", 1, 8, 1 << 28), const std::runtime_error&);
+}
+
+TEST_CASE("tiff_predictor: sample sizes", "[filters]") {
+    for (int bpc : { 1, 2, 4, 8, 16 }) {
+        for (int colors : { 1, 2, 3, 4 }) {
+            const int columns = 7, rows = 3;
+            std::size_t per_row = columns * colors;
+            unsigned mask = (1u << bpc) - 1;
+            std::vector<unsigned> samples, differences;
+            for (std::size_t n = 0; n < rows * per_row; ++n) {
+                samples.push_back(static_cast<unsigned>(n * 2654435761u >> 9) & mask);
+                differences.push_back(n % per_row < static_cast<std::size_t>(colors)
+                    ? samples[n]
+                    : (samples[n] - samples[n - colors]) & mask);
+            }
+            auto encoded = pack_samples(differences, per_row, bpc);
+            INFO(bpc << " bits, " << colors << " colors");
+            CHECK(pdf::tiff_predictor(to_slice(to_string(encoded)), colors, bpc, columns) == pack_samples(samples, per_row, bpc));
+        }
+    }
+    CHECK_THROWS(pdf::tiff_predictor("abc", 1, 32, 3));
+}
+
+TEST_CASE("tiff_predictor: hostile parameters", "[filters]") {
+    // 8 * 2^29 bits wraps round to an empty row in 32 bits, which never moves on
+    CHECK_THROWS(pdf::tiff_predictor("abc", 1, 8, 1 << 29));
+    CHECK_THROWS(pdf::tiff_predictor("abc", 1 << 16, 16, 1 << 16));
+    CHECK_THROWS(pdf::tiff_predictor("abc", 1, 8, 0x7fffffff));
+    CHECK_THROWS(pdf::png_predictor("abc", 1, 8, 1 << 28));
+    CHECK_THROWS(pdf::png_predictor("abc", -1, 8, 3));
+}
+
+TEST_CASE("decode_stream: tiff predictor", "[filters]") {
+    using namespace pdf;
+    atom_table t;
+    auto dict = *parser("<</Filter /FlateDecode /DecodeParms <</Predictor 2 /Colors 3 /Columns 2>>>>", t).next_object();
+    auto compressed = compress_string(std::string("\x01\x02\x03\x01\x01\x01\x0a\x0a\x0a\xff\x00\x01", 12));
+    CHECK(to_string(decode_stream(dict, to_slice(compressed))) == std::string("\x01\x02\x03\x02\x03\x04\x0a\x0a\x0a\x09\x0a\x0b", 12));
+}
+
+TEST_CASE("lzw_decode: specification example", "[filters]") {
+    // codes 256 45 258 258 65 259 66 257, from the PDF reference
+    auto encoded = std::string("\x80\x0b\x60\x50\x22\x0c\x0c\x85\x01", 9);
+    CHECK(to_string(pdf::lzw_decode(to_slice(encoded))) == "-----A---B");
+    CHECK(lzw_encode("-----A---B", 1) == encoded);
+}
+
+TEST_CASE("lzw_decode: round trip", "[filters]") {
+    std::string text;
+    for (int i = 0; i < 20000; ++i)
+        text += "BT /F1 12 Tf (" + std::to_string(i * 7919 % 10007) + ") Tj ET\n";
+    text += std::string(5000, 'a');
+    for (int early : { 0, 1 }) {
+        auto encoded = lzw_encode(text, early);
+        CHECK(to_string(pdf::lzw_decode(to_slice(encoded), early == 1)) == text);
+        CHECK(to_string(pdf::lzw_decode(to_slice(encoded), early == 0)) != text);
+    }
+    CHECK(pdf::lzw_decode(to_slice(lzw_encode("", 1))).empty());
+    CHECK_THROWS(pdf::lzw_decode(to_slice(std::string("\x80\x7f\xff\xff", 4))));
+}
+
+TEST_CASE("lzw_filter: chunked", "[filters]") {
+    std::string text;
+    for (int i = 0; i < 3000; ++i)
+        text += "q 1 0 0 1 " + std::to_string(i) + " 0 cm Q\n";
+    auto encoded = lzw_encode(text, 1);
+    for (std::size_t in_size : { 1, 3, 4096 }) {
+        pdf::lzw_filter filter;
+        std::string decoded;
+        char out[5];
+        std::size_t offset = 0;
+        for (bool done = false; !done;) {
+            auto part = to_slice(encoded).skip(offset).left(in_size);
+            auto r = filter.decode(part, out, sizeof out, offset + part.length() == encoded.size());
+            offset += r.consumed;
+            decoded.append(out, r.produced);
+            done = r.done;
+        }
+        CHECK(decoded == text);
+    }
+
+    // a stream without an end-of-data code ends with its input
+    auto truncated = encoded.substr(0, encoded.size() / 2);
+    auto partial = to_string(pdf::lzw_decode(to_slice(truncated)));
+    CHECK(!partial.empty());
+    CHECK(text.compare(0, partial.size(), partial) == 0);
+}
+
+TEST_CASE("decode_stream: lzw", "[filters]") {
+    using namespace pdf;
+    atom_table t;
+    std::string text(3000, 'x');
+    for (std::size_t i = 0; i < text.size(); i += 5)
+        text[i] = static_cast<char>('a' + i % 26);
+    auto late = *parser("<</Filter /LZWDecode /DecodeParms <</EarlyChange 0>>>>", t).next_object();
+    CHECK(to_string(decode_stream(late, to_slice(lzw_encode(text, 0)))) == text);
+    auto early = *parser("<</Filter [/LZWDecode]>>", t).next_object();
+    std::vector<char> buffer(text.size());
+    CHECK(decode_stream(early, to_slice(lzw_encode(text, 1)), buffer.data(), buffer.size()) == text.size());
+    CHECK(to_string(buffer) == text);
+}
+
+TEST_CASE("ascii_hex_decode: digits and whitespace", "[filters]") {
+    std::string data;
+    for (int i = 0; i < 3000; ++i)
+        data += static_cast<char>(i * 2654435761u >> 11);
+    for (std::size_t line : { 1, 16, 40, 5000 }) {
+        auto encoded = hex_encode(data, line);
+        CHECK(to_string(pdf::ascii_hex_decode(to_slice(encoded))) == data);
+        CHECK(to_string(pdf::ascii_hex_decode(to_slice(encoded + "ffff"))) == data); // nothing after '>'
+    }
+    CHECK(to_string(pdf::ascii_hex_decode("61 6\r\n2 7>")) == "abp");
+    CHECK(to_string(pdf::ascii_hex_decode("616")) == "a`");
+    CHECK_THROWS(pdf::ascii_hex_decode("0123456789abcdef0123456789abcdeg>"));
+}
+
+TEST_CASE("ascii85_decode: groups", "[filters]") {
+    std::string data;
+    for (int i = 0; i < 3000; ++i)
+        data += static_cast<char>(i % 9 < 5 ? 0 : i * 2654435761u >> 11);
+    for (std::size_t size : { data.size(), data.size() - 1, data.size() - 2, data.size() - 3 })
+        for (std::size_t line : { 1, 3, 16, 5000 })
+            CHECK(to_string(pdf::ascii85_decode(to_slice(a85_encode(data.substr(0, size), line)))) == data.substr(0, size));
+    CHECK(to_string(pdf::ascii85_decode("87cURD]i,\"Ebo80~>")) == "Hello World!");
+    CHECK(to_string(pdf::ascii85_decode("z 87cUR~>")) == std::string("\0\0\0\0Hell", 8));
+    CHECK(to_string(pdf::ascii85_decode("87cURD]i")) == "Hello ");
+    CHECK_THROWS(pdf::ascii85_decode("87c{URD~>"));
+}
+
+TEST_CASE("ascii_hex_filter: chunked", "[filters]") {
+    std::string data;
+    for (int i = 0; i < 2000; ++i)
+        data += static_cast<char>(i * 7);
+    for (int hex = 0; hex < 2; ++hex) {
+        auto encoded = hex ? hex_encode(data, 32) : a85_encode(data, 20);
+        for (std::size_t in_size : { 1, 7, 4096 }) {
+            std::unique_ptr<pdf::stream_filter> filter(hex
+                ? static_cast<pdf::stream_filter*>(new pdf::ascii_hex_filter())
+                : new pdf::ascii85_filter());
+            std::string decoded;
+            char out[3];
+            std::size_t offset = 0;
+            for (bool done = false; !done;) {
+                auto part = to_slice(encoded).skip(offset).left(in_size);
+                auto r = filter->decode(part, out, sizeof out, offset + part.length() == encoded.size());
+                offset += r.consumed;
+                decoded.append(out, r.produced);
+                done = r.done;
+            }
+            CHECK(decoded == data);
+        }
+    }
+}
+
+TEST_CASE("decode_hexstring: parsed values", "[filters]") {
+    using namespace pdf;
+    atom_table t;
+    auto a = *parser("[<48656c6c6f> <4 8 6\n5 7> <> <ABCDEF0123456789abcdef0123456789ABCDEF01234567>]", t).next_object();
+    CHECK(to_string(decode_hexstring(a[0])) == "Hello");
+    CHECK(to_string(decode_hexstring(a[1])) == "Hep");
+    CHECK(decode_hexstring(a[2]).empty());
+    CHECK(to_string(decode_hexstring(a[3])) ==
+          std::string("\xab\xcd\xef\x01\x23\x45\x67\x89\xab\xcd\xef\x01\x23\x45\x67\x89\xab\xcd\xef\x01\x23\x45\x67", 23));
+    CHECK(to_string(decode_hexstring(variant::make_hexstring("deadbeef"))) == "\xde\xad\xbe\xef");
+}
+
+TEST_CASE("decode_stream: ascii filters", "[filters]") {
+    using namespace pdf;
+    atom_table t;
+    std::string text;
+    for (int i = 0; i < 500; ++i)
+        text += "BT /F1 12 Tf (" + std::to_string(i) + ") Tj ET\n";
+    auto both = *parser("<</Filter [/ASCII85Decode /FlateDecode]>>", t).next_object();
+    CHECK(to_string(decode_stream(both, to_slice(a85_encode(compress_string(text), 16)))) == text);
+    auto hex = *parser("<</Filter /ASCIIHexDecode>>", t).next_object();
+    std::vector<char> buffer(text.size());
+    CHECK(decode_stream(hex, to_slice(hex_encode(text, 40)), buffer.data(), buffer.size()) == text.size());
+    CHECK(to_string(buffer) == text);
+}
+
+TEST_CASE("decode_stream: filters", "[filters]") {
+    using namespace pdf;
+
+    atom_table t;
+    auto none = *parser("<</Length 5>>", t).next_object();
+    CHECK(to_string(decode_stream(none, "hello")) == "hello");
+
+    auto compressed = compress_string("hello");
+    auto flate = *parser("<</Filter [/FlateDecode]>>", t).next_object();
+    CHECK(to_string(decode_stream(flate, to_slice(compressed))) == "hello");
+
+    auto unsupported = *parser("<</Filter /JBIG2Decode>>", t).next_object();
+    CHECK_THROWS(decode_stream(unsupported, "hello"));
+}
+
+TEST_CASE("flate_filter: chunked", "[filters]") {
+    std::string text;
+    for (int i = 0; i < 2000; ++i)
+        text += "BT /F1 12 Tf (" + std::to_string(i) + ") Tj ET\n";
+    auto compressed = compress_string(text);
+    for (std::size_t in_size : { 1, 13, 4096 }) {
+        pdf::flate_filter filter;
+        std::string decoded;
+        char out[7];
+        std::size_t offset = 0;
+        for (bool done = false; !done;) {
+            auto part = to_slice(compressed).skip(offset).left(in_size);
+            auto r = filter.decode(part, out, sizeof out, offset + part.length() == compressed.size());
+            offset += r.consumed;
+            decoded.append(out, r.produced);
+            done = r.done;
+        }
+        CHECK(decoded == text);
+        CHECK(offset == compressed.size());
+    }
+}
+
+TEST_CASE("decode_stream: into a buffer", "[filters]") {
+    using namespace pdf;
+
+    atom_table t;
+    std::string text(10000, 'x');
+    auto compressed = compress_string(text);
+    auto dict = *parser("<</Filter /FlateDecode /DL 10000>>", t).next_object();
+    CHECK(decoded_length(dict, to_slice(compressed)) == 10000);
+
+    std::vector<char> buffer(decoded_length(dict, to_slice(compressed)));
+    CHECK(decode_stream(dict, to_slice(compressed), buffer.data(), buffer.size()) == 10000);
+    CHECK(to_string(buffer) == text);
+
+    // too small: the start is decoded, and the full length returned
+    std::vector<char> small(100);
+    CHECK(decode_stream(dict, to_slice(compressed), small.data(), small.size()) == 10000);
+    CHECK(to_string(small) == text.substr(0, 100));
+
+    auto none = *parser("<</Length 5>>", t).next_object();
+    CHECK(decoded_length(none, "hello") == 5);
+    CHECK(decode_stream(none, "hello", small.data(), 3) == 5);
+    CHECK(std::string(small.data(), 3) == "hel");
+}
+
+TEST_CASE("decode_stream: into an arena", "[filters]") {
+    using namespace pdf;
+
+    atom_table t;
+    std::string text;
+    for (int i = 0; i < 10000; ++i)
+        text += std::to_string(i) + " ";
+    auto compressed = compress_string(text);
+    auto with_length = *parser(("<</Filter /FlateDecode /DL " + std::to_string(text.size()) + ">>").c_str(), t).next_object();
+    auto without = *parser("<</Filter /FlateDecode>>", t).next_object();
+
+    tools::arena arena(1 << 10);
+    auto decoded = decode_stream(with_length, to_slice(compressed), arena);
+    CHECK(decoded == to_slice(text));
+    // exactly /DL was allocated
+    CHECK(arena.size() == text.size());
+
+    // the guess was too small, so the output grew
+    CHECK(decode_stream(without, to_slice(compressed), arena) == to_slice(text));
+    CHECK(decode_stream(without, to_slice(compress_string("")), arena).empty());
+    auto none = *parser("<</Length 5>>", t).next_object();
+    CHECK(decode_stream(none, "hello", arena) == "hello");
+}
@@ -0,0 +1,147 @@
+#include "catch.hpp"
+#include "hint_tables.hpp"
+#include "parser.hpp"
+
+#include <string>
+#include <vector>
+
+using pdf::hint_tables;
+
+namespace {
+
+    // the opposite of the bit reader in hint_tables.cpp
+    class bit_writer {
+    public:
+        void write(std::uint64_t value, unsigned bits) {
+            while (bits-- > 0) {
+                if (position % 8 == 0)
+                    data += '\0';
+                if ((value >> bits) & 1)
+                    data.back() = static_cast<char>(data.back() | (0x80 >> position % 8));
+                ++position;
+            }
+        }
+
+        void align() {
+            position = (position + 7) / 8 * 8;
+        }
+
+        std::string data;
+
+    private:
+        std::size_t position = 0;
+    };
+
+    /*
+        Three pages and three shared object groups, the first of which is in the first
+        page. The hint stream is at 900 and 200 bytes long.
+    */
+    auto hint_stream() -> std::string {
+        bit_writer w;
+        // page offset hint table header
+        for (auto field : { std::make_pair(2, 32), { 500, 32 }, { 2, 16 }, { 100, 32 }, { 8, 16 }, { 10, 32 }, { 4, 16 },
+                            { 50, 32 }, { 6, 16 }, { 2, 16 }, { 3, 16 }, { 0, 16 }, { 1, 16 } })
+            w.write(field.first, field.second);
+        auto item = [&](std::vector<int> values, unsigned bits) {
+            for (auto v : values)
+                w.write(v, bits);
+            w.align();
+        };
+        item({ 1, 0, 3 }, 2); // objects
+        item({ 200, 50, 0 }, 8); // lengths
+        item({ 1, 2, 0 }, 2); // shared object references
+        item({ 0, 1, 2 }, 3); // the shared object groups referred to
+        item({ 1, 2, 3 }, 4); // content stream offsets
+        item({ 1, 2, 3 }, 6); // content stream lengths
+        auto shared_offset = w.data.size();
+
+        // shared object hint table header
+        for (auto field : { std::make_pair(20, 32), { 1100, 32 }, { 1, 32 }, { 3, 32 }, { 2, 16 }, { 40, 32 }, { 5, 16 } })
+            w.write(field.first, field.second);
+        item({ 0, 10, 20 }, 5); // lengths
+        item({ 0, 1, 0 }, 1); // signatures
+        for (int i = 0; i < 4; ++i)
+            w.write(0xffffffff, 32);
+        item({ 0, 1, 2 }, 2); // objects
+
+        return "5 0 obj\n<</S " + std::to_string(shared_offset) + " /Length " + std::to_string(w.data.size()) +
+            ">>\nstream\n" + w.data + "\nendstream\nendobj\n";
+    }
+
+    auto parse(const std::string& pdf, pdf::tools::atom_table& atoms) -> pdf::indirect_object {
+        return pdf::parser(pdf::tools::slice(pdf.data(), pdf.size()), atoms).expect_indirect_object();
+    }
+
+}
+
+TEST_CASE("hint_tables: tables", "[linearized]") {
+    pdf::tools::atom_table atoms;
+    auto stream = hint_stream();
+    std::string lin = "1 0 obj <</Linearized 1 /L 2000 /H [900 200] /O 7 /E 800 /N 3 /T 1800>> endobj";
+    hint_tables hints(parse(stream, atoms), parse(lin, atoms).object);
+
+    REQUIRE(hints.page_count() == 3);
+    CHECK(hints.page(0).objects == 3);
+    CHECK(hints.page(0).offset == 500);
+    CHECK(hints.page(0).length == 300);
+    CHECK(hints.page(0).shared == std::vector<unsigned>{ 0 });
+    CHECK(hints.page(0).content_offset == 11);
+    CHECK(hints.page(0).content_length == 51);
+    CHECK(hints.page(1).offset == 800);
+    CHECK(hints.page(1).length == 150);
+    CHECK(hints.page(1).shared == std::vector<unsigned>({ 1, 2 }));
+    // after the hint stream
+    CHECK(hints.page(2).offset == 1150);
+    CHECK(hints.page(2).objects == 5);
+    CHECK(hints.page(2).shared.empty());
+    CHECK(hints.page(2).content_length == 53);
+    CHECK_THROWS(hints.page(3));
+
+    REQUIRE(hints.shared_count() == 3);
+    CHECK(hints.shared(0).first_page);
+    CHECK(!hints.shared(1).first_page);
+    CHECK(hints.shared(1).offset == 1300);
+    CHECK(hints.shared(1).length == 50);
+    CHECK(hints.shared(1).first_object == 20);
+    CHECK(hints.shared(1).objects == 2);
+    CHECK(hints.shared(2).offset == 1350);
+    CHECK(hints.shared(2).first_object == 22);
+    CHECK(hints.shared(2).objects == 3);
+
+    auto first = hints.page_extents(0);
+    REQUIRE(first.size() == 1);
+    CHECK(first[0].offset == 500);
+    CHECK(first[0].length == 300);
+    // the groups are adjacent, so they are merged
+    auto second = hints.page_extents(1);
+    REQUIRE(second.size() == 2);
+    CHECK(second[0].offset == 800);
+    CHECK(second[0].length == 150);
+    CHECK(second[1].offset == 1300);
+    CHECK(second[1].length == 110);
+}
+
+TEST_CASE("hint_tables: errors", "[linearized]") {
+    pdf::tools::atom_table atoms;
+    auto stream = hint_stream();
+    std::string lin = "1 0 obj <</Linearized 1 /L 2000 /H [900 200] /O 7 /E 800 /N 3 /T 1800>> endobj";
+    auto params = parse(lin, atoms).object;
+    // truncated
+    auto data_begin = stream.find("stream\n") + 7, data_end = stream.find("\nendstream");
+    auto length = stream.find(" /Length ") + 9;
+    auto short_stream = stream.substr(0, length) + "10" + stream.substr(stream.find(">>"), data_begin - stream.find(">>")) +
+        stream.substr(data_begin, 10) + stream.substr(data_end);
+    CHECK_THROWS(hint_tables(parse(short_stream, atoms), params).page_count());
+    // more pages than there are entries for
+    std::string many = "1 0 obj <</Linearized 1 /L 2000 /H [900 200] /O 7 /E 800 /N 3000 /T 1800>> endobj";
+    CHECK_THROWS(hint_tables(parse(stream, atoms), parse(many, atoms).object).page_count());
+    // rejected before allocating millions of pages
+    std::string most = "1 0 obj <</Linearized 1 /L 2000 /H [900 200] /O 7 /E 800 /N 16777215 /T 1800>> endobj";
+    try {
+        hint_tables(parse(stream, atoms), parse(most, atoms).object);
+        FAIL("no exception");
+    } catch (pdf::format_error& e) {
+        CHECK(std::string(e.what()) == "hint_tables: table too short for /N pages");
+    }
+    CHECK_THROWS(hint_tables(parse("5 0 obj <</S 0>> endobj", atoms), params).page_count());
+}
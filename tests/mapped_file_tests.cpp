@@ -0,0 +1,31 @@
+#include "catch.hpp"
+#include "mapped_file.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+using pdf::mapped_file;
+
+TEST_CASE("mapped_file: contents", "[mapped_file]") {
+    const std::string filename = std::string(P_tmpdir) + "/pdfp_mapped_file_tests.pdf";
+    std::ofstream(filename) << "%PDF-1.4\n%%EOF\n";
+
+    mapped_file file(filename, pdf::access_pattern::sequential);
+    CHECK(file.size() == 15);
+    CHECK(file.data() == "%PDF-1.4\n%%EOF\n");
+
+    mapped_file populated(filename, pdf::access_pattern::random, true);
+    CHECK(populated.data() == "%PDF-1.4\n%%EOF\n");
+
+    mapped_file moved(std::move(file));
+    CHECK(moved.data() == "%PDF-1.4\n%%EOF\n");
+    CHECK(file.size() == 0);
+    CHECK(file.data().empty());
+
+    std::ofstream(filename).close();
+    CHECK(mapped_file(filename).data().empty());
+
+    std::remove(filename.c_str());
+    CHECK_THROWS(mapped_file(filename).size());
+}
@@ -0,0 +1,189 @@
+#include "catch.hpp"
+#include "test_tools.hpp"
+#include "tools.hpp"
+#include "object_loader.hpp"
+#include "object_stream.hpp"
+#include "xref_table.hpp"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using pdf::tools::objref;
+using pdf::tools::slice;
+using pdf::object_loader;
+using pdf::xref_table;
+
+namespace {
+
+    auto to_string(const pdf::tools::variant& v) -> std::string {
+        std::ostringstream os;
+        os << v;
+        return os.str();
+    }
+
+    // append an xref stream row with field widths [1 2 1]
+    void row(std::string& rows, int type, int field2, int field3) {
+        rows += static_cast<char>(type);
+        rows += static_cast<char>(field2 >> 8);
+        rows += static_cast<char>(field2);
+        rows += static_cast<char>(field3);
+    }
+
+    /*
+        Object 1 is an object stream containing objects 2, 3, 4 and 6.
+        Object 5 is a stream whose /Length is object 6.
+        Object 7 is the xref stream.
+    */
+    auto make_pdf() -> std::string {
+        std::vector<int> ids = { 2, 3, 4, 6 };
+        std::vector<std::string> objects = { "<</Root 5 0 R>>", "(hello)", "5 0 R", "11" };
+        std::string pairs, body;
+        for (std::size_t i = 0; i < ids.size(); ++i) {
+            pairs += std::to_string(ids[i]) + " " + std::to_string(body.size()) + " ";
+            body += objects[i] + "\n";
+        }
+        std::string objstm = pairs + body;
+
+        std::string pdf = "%PDF-1.5\n";
+        int objstm_offset = pdf.size();
+        pdf += "1 0 obj\n<</Type /ObjStm /N 4 /First " + std::to_string(pairs.size()) +
+            " /Length " + std::to_string(objstm.size()) + ">>\nstream\n" + objstm + "\nendstream\nendobj\n";
+        int stream_offset = pdf.size();
+        pdf += "5 0 obj\n<</Length 6 0 R>>\nstream\nhello world\nendstream\nendobj\n";
+        int xref_offset = pdf.size();
+
+        std::string rows;
+        row(rows, 0, 0, 255);
+        row(rows, 1, objstm_offset, 0);
+        row(rows, 2, 1, 0);
+        row(rows, 2, 1, 1);
+        row(rows, 2, 1, 2);
+        row(rows, 1, stream_offset, 0);
+        row(rows, 2, 1, 3);
+        row(rows, 1, xref_offset, 0);
+        pdf += "7 0 obj\n<</Type /XRef /Size 8 /W [1 2 1] /Length " + std::to_string(rows.size()) +
+            ">>\nstream\n" + rows + "\nendstream\nendobj\n";
+        pdf += "startxref\n" + std::to_string(xref_offset) + "\n%%EOF\n";
+        return pdf;
+    }
+
+}
+
+TEST_CASE("object_loader: compressed objects", "[objects]") {
+    using namespace pdf;
+
+    auto pdf = make_pdf();
+    xref_table xref(to_slice(pdf));
+    xref.get_from(pdf.find("7 0 obj"));
+    CHECK(xref[3].type() == xref_type::compressed);
+    CHECK(xref[3].stream() == 1);
+    CHECK(xref[3].index() == 1);
+
+    object_loader objects(to_slice(pdf), xref);
+    auto root = objects.get(objref(2, 0));
+    CHECK(root.ref.id == 2);
+    CHECK(root.object[names::Root].is_ref(5, 0));
+    CHECK(!root.stream);
+
+    auto hello = objects.get(objref(3, 0)).object;
+    CHECK(hello.is_string("(hello)"));
+    // the object stream is only decoded once
+    CHECK(objects.get(objref(3, 0)).object.get_string().begin() == hello.get_string().begin());
+
+    CHECK(objects.get(objref(4, 0)).object.is_ref(5, 0));
+    CHECK(objects.get(objref(6, 0)).object.is_integer(11));
+}
+
+TEST_CASE("object_loader: uncompressed objects", "[objects]") {
+    using namespace pdf;
+
+    auto pdf = make_pdf();
+    xref_table xref(to_slice(pdf));
+    xref.get_from(pdf.find("7 0 obj"));
+    object_loader objects(to_slice(pdf), xref);
+
+    // the indirect /Length is resolved from the object stream
+    auto stream = objects.get(objref(5, 0));
+    REQUIRE(stream.stream);
+    CHECK(*stream.stream == "hello world");
+
+    CHECK(objects.get(objref(1, 0)).object[names::Type].get_name() == names::ObjStm);
+    CHECK(objects.get(objref(0, 0)).object.is_null());
+    CHECK(objects.get(objref(100, 0)).object.is_null());
+}
+
+TEST_CASE("object_stream: errors", "[objects]") {
+    using namespace pdf;
+
+    atom_table t;
+    CHECK_THROWS(object_stream(parser("1 0 obj <</Type /ObjStm /N 1 /First 4>> endobj", t).expect_indirect_object()));
+    CHECK_THROWS(object_stream(parser("1 0 obj <</Type /XRef /N 1 /First 4>> stream\n1 0 1\nendstream endobj", t).expect_indirect_object()));
+    CHECK_THROWS(object_stream(parser("1 0 obj <</Type /ObjStm /N 2 /First 4>> stream\n1 0 1\nendstream endobj", t).expect_indirect_object()));
+
+    object_stream s(parser("1 0 obj <</Type /ObjStm /N 1 /First 4>> stream\n9 0 true\nendstream endobj", t).expect_indirect_object());
+    CHECK(s.size() == 1);
+    CHECK(s.id(0) == 9);
+    CHECK(s.get(0).is_boolean(true));
+    CHECK_THROWS(s.get(1));
+}
+
+TEST_CASE("object_loader: reconstructed object streams", "[objects]") {
+    using namespace pdf;
+
+    // lose the xref stream
+    auto pdf = make_pdf();
+    pdf.resize(pdf.find("7 0 obj"));
+    xref_table xref(to_slice(pdf));
+    xref.reconstruct();
+    CHECK(xref[3].type() == xref_type::compressed);
+    CHECK(xref[5].type() == xref_type::in_use);
+
+    object_loader objects(to_slice(pdf), xref);
+    CHECK(objects.get(objref(3, 0)).object.is_string("(hello)"));
+    CHECK(*objects.get(objref(5, 0)).stream == "hello world");
+}
+
+TEST_CASE("object_loader: get_all", "[objects]") {
+    using namespace pdf;
+
+    auto pdf = make_pdf();
+    xref_table xref(to_slice(pdf));
+    xref.get_from(pdf.find("7 0 obj"));
+    object_loader objects(to_slice(pdf), xref);
+    object_loader expected(to_slice(pdf), xref);
+
+    // out of order, with duplicates, free and missing objects
+    std::vector<objref> refs = { objref(5, 0), objref(3, 0), objref(0, 0), objref(1, 0), objref(6, 0),
+                                 objref(5, 0), objref(100, 0), objref(2, 0), objref(7, 0) };
+    auto all = objects.get_all(refs);
+    REQUIRE(all.size() == refs.size());
+    for (std::size_t i = 0; i < refs.size(); ++i) {
+        auto object = expected.get(refs[i]);
+        CHECK(all[i].ref.id == object.ref.id);
+        CHECK(to_string(all[i].object) == to_string(object.object));
+        CHECK(bool(all[i].stream) == bool(object.stream));
+        if (object.stream)
+            CHECK(*all[i].stream == *object.stream);
+    }
+    CHECK(objects.get_all({}).empty());
+}
+
+TEST_CASE("object_loader: damaged objects", "[objects]") {
+    // object 1 is cut short, and is followed by a megabyte of intact objects
+    std::string pdf = "%PDF-1.4\n1 0 obj\n<< /Kids [2 0 R\nendobj\n";
+    std::string padding(10000, 'x');
+    for (int i = 2; i < 100; ++i)
+        pdf += std::to_string(i) + " 0 obj\n(" + padding + ")\nendobj\n";
+    xref_table xref(to_slice(pdf));
+    xref.reconstruct();
+    REQUIRE(xref[1].in_use());
+
+    // the damaged object is only looked for up to the next object
+    counting_source source(to_slice(pdf));
+    object_loader objects(source, xref);
+    CHECK_THROWS(objects.get(objref(1, 0)));
+    CHECK(source.bytes_read < 2 * pdf::initial_window);
+    auto intact = "(" + padding + ")";
+    CHECK(objects.get(objref(50, 0)).object.is_string(intact.c_str()));
+}
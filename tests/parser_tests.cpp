@@ -288,3 +288,92 @@ TEST_CASE("next_object: nested dict", "[parser]") {
     CHECK(d[t["/Start"]].is_ref(10, 0));
     CHECK(d[t["/End"]].is_ref(11, 0));
 }
+
+TEST_CASE("expect_indirect_object: simple", "[parser]") {
+    using namespace pdf;
+
+    atom_table t;
+    parser p("12 0 obj\n<</Size 3 /Root 2 0 R>>\nendobj\n", t);
+    auto o = p.expect_indirect_object();
+    CHECK(o.ref.id == 12);
+    CHECK(o.ref.gen == 0);
+    CHECK(o.object.is_dict());
+    CHECK(o.object[names::Size].is_integer(3));
+    CHECK(o.object[names::Root].is_ref(2, 0));
+    CHECK(!o.stream);
+    CHECK(!p.next_object());
+
+    parser p2("3 1 obj 4 0 R endobj 5 0 obj endobj", t);
+    CHECK(p2.expect_indirect_object().object.is_ref(4, 0));
+    CHECK(p2.expect_indirect_object().object.is_null());
+}
+
+TEST_CASE("expect_indirect_object: stream", "[parser]") {
+    using namespace pdf;
+
+    atom_table t;
+    parser p("1 0 obj <</Length 10>> stream\r\n0123456789\r\nendstream endobj", t);
+    auto o = p.expect_indirect_object();
+    CHECK(o.ref.id == 1);
+    REQUIRE(o.stream);
+    CHECK(*o.stream == "0123456789");
+    CHECK(!p.next_object());
+}
+
+TEST_CASE("expect_indirect_object: stream with bad length", "[parser]") {
+    using namespace pdf;
+
+    atom_table t;
+    parser p("1 0 obj <</Length 4>> stream\n0123456789\nendstream\nendobj", t);
+    auto o = p.expect_indirect_object();
+    REQUIRE(o.stream);
+    CHECK(*o.stream == "0123456789");
+
+    parser p2("1 0 obj <</Length 400>> stream\n0123456789\r\nendstream\nendobj", t);
+    CHECK(*p2.expect_indirect_object().stream == "0123456789");
+
+    parser p3("1 0 obj <<>> stream\nendstream\nendobj", t);
+    CHECK(*p3.expect_indirect_object().stream == "");
+
+    parser p4("1 0 obj <</Length 10>> stream\n0123456789 endobj", t);
+    CHECK_THROWS(p4.expect_indirect_object());
+}
+
+TEST_CASE("expect_indirect_object: indirect stream length", "[parser]") {
+    using namespace pdf;
+
+    atom_table t;
+    const char* pdf = "1 0 obj <</Length 2 0 R>> stream\nendstream data\nendstream endobj";
+    int calls = 0;
+    parser p(pdf, t);
+    auto o = p.expect_indirect_object([&](objref ref) {
+        ++calls;
+        CHECK(ref.id == 2);
+        return 14;
+    });
+    CHECK(calls == 1);
+    CHECK(*o.stream == "endstream data");
+
+    // without a resolver we have to scan, which finds the wrong endstream
+    parser p2(pdf, t);
+    CHECK_THROWS(p2.expect_indirect_object());
+
+    // a length beyond the data isn't cut down to 32 bits, which would be 14 here
+    parser p3(pdf, t);
+    CHECK_THROWS(p3.expect_indirect_object([](objref) { return 4294967310LL; }));
+}
+
+TEST_CASE("expect_indirect_object: large integers", "[parser]") {
+    using namespace pdf;
+
+    atom_table t;
+    parser p("1 0 obj <</Length 4294967310>> stream\nendstream data\nendstream endobj", t);
+    CHECK_THROWS(p.expect_indirect_object());
+
+    parser p2("4294967297 0 obj null endobj", t);
+    CHECK_THROWS(p2.expect_indirect_object());
+    parser p3("1 4294967296 obj null endobj", t);
+    CHECK_THROWS(p3.expect_indirect_object());
+    parser p4("1 0 obj [4294967297 0 R] endobj", t);
+    CHECK_THROWS(p4.expect_indirect_object());
+}
@@ -0,0 +1,154 @@
+#include "catch.hpp"
+#include "test_tools.hpp"
+#include "byte_source.hpp"
+#include "pdf_dictionaries.hpp"
+#include "progressive_parser.hpp"
+
+#include <cstdio>
+#include <map>
+#include <string>
+
+using pdf::growing_source;
+using pdf::progressive_parser;
+using pdf::tools::objref;
+using pdf::tools::slice;
+
+namespace {
+
+    auto number(std::uint64_t n) -> std::string {
+        char buffer[11];
+        snprintf(buffer, sizeof buffer, "%010llu", static_cast<unsigned long long>(n));
+        return buffer;
+    }
+
+    auto entry(std::uint64_t offset) -> std::string {
+        return number(offset) + " 00000 n\r\n";
+    }
+
+    /*
+        A linearized file with two pages. The first page section holds the catalog (11),
+        the first page (12) and its contents (13). The rest holds the page tree (1), the
+        second page (2) and its contents (3). Numbers are written with a fixed width, so
+        offsets can be filled in without moving anything.
+    */
+    auto linearized_pdf() -> std::string {
+        std::map<int, std::uint64_t> offsets;
+        std::string pdf;
+        for (int pass = 0; pass < 2; ++pass) {
+            auto first_xref = offsets[100], main_xref = offsets[101], end_of_first_page = offsets[102];
+            auto length = offsets[103];
+            pdf = "%PDF-1.4\n%\xe2\xe3\xcf\xd3\n";
+            pdf += "10 0 obj\n<</Linearized 1 /L " + number(length) + " /H [0 0] /O 12 /E " +
+                number(end_of_first_page) + " /N 2 /T " + number(main_xref) + ">>\nendobj\n";
+            offsets[100] = pdf.size();
+            pdf += "xref\n10 4\n" + entry(offsets[10]) + entry(offsets[11]) + entry(offsets[12]) + entry(offsets[13]);
+            pdf += "trailer\n<</Size 14 /Root 11 0 R /Prev " + number(main_xref) + ">>\n";
+            auto object = [&](int id, const std::string& body) {
+                offsets[id] = pdf.size();
+                pdf += std::to_string(id) + " 0 obj\n" + body + "\nendobj\n";
+            };
+            offsets[10] = pdf.find("10 0 obj");
+            object(11, "<</Type /Catalog /Pages 1 0 R>>");
+            object(12, "<</Type /Page /Parent 1 0 R /Contents 13 0 R>>");
+            object(13, "(first page)");
+            offsets[102] = pdf.size();
+            object(1, "<</Type /Pages /Kids [12 0 R 2 0 R] /Count 2>>");
+            object(2, "<</Type /Page /Parent 1 0 R /Contents 3 0 R>>");
+            object(3, "(second page)");
+            offsets[101] = pdf.size();
+            pdf += "xref\n0 4\n0000000000 65535 f\r\n" + entry(offsets[1]) + entry(offsets[2]) + entry(offsets[3]);
+            pdf += "trailer\n<</Size 4>>\nstartxref\n" + std::to_string(first_xref) + "\n%%EOF\n";
+            offsets[103] = pdf.size();
+        }
+        return pdf;
+    }
+
+}
+
+TEST_CASE("growing_source: read", "[linearized]") {
+    growing_source source(10);
+    CHECK(source.size() == 0);
+    CHECK(!source.complete());
+    std::string contents = "0123456789abcdefghijklmnopqrstuvwxyz";
+    source.append(to_slice(contents.substr(0, 5)));
+    CHECK(source.size() == 5);
+    CHECK(source.read(3, 10).data == "34");
+    source.append(to_slice(contents.substr(5)));
+    CHECK(source.size() == contents.size());
+    CHECK(source.read(0, 100).data == to_slice(contents));
+    CHECK(source.read(8, 15).data == "89abcdefghijklm");
+    CHECK(source.read(36, 1).data.empty());
+    source.close();
+    CHECK(source.complete());
+}
+
+TEST_CASE("progressive_parser: linearized", "[linearized]") {
+    auto pdf = linearized_pdf();
+    auto end_of_first_page = pdf.find("\n1 0 obj") + 1;
+    growing_source source(64);
+    progressive_parser parser(source);
+
+    // the first page is ready as soon as it has arrived, but not before
+    std::size_t offset = 0;
+    for (; offset < pdf.size() && !parser.first_page_ready(); offset += 7)
+        source.append(to_slice(pdf.substr(offset, 7)));
+    CHECK(offset >= end_of_first_page);
+    CHECK(offset < end_of_first_page + 7);
+    REQUIRE(parser.linearized());
+    CHECK(pdf::linearization_dict(parser.linearization()).N() == 2);
+    CHECK(parser.first_page().id == 12);
+    // there is no hint stream
+    CHECK_THROWS(parser.hints());
+    CHECK(!parser.ready());
+
+    auto root = parser.xref().trailer()[pdf::names::Root].get_ref();
+    CHECK(parser.objects().get(root).object[pdf::names::Type].get_name() == pdf::names::Catalog);
+    CHECK(parser.objects().get(objref(13, 0)).object.is_string("(first page)"));
+    // the second page isn't in the first page's section
+    CHECK(parser.objects().get(objref(3, 0)).object.is_null());
+
+    source.append(to_slice(pdf.substr(offset)));
+    CHECK(!parser.ready());
+    source.close();
+    REQUIRE(parser.ready());
+    CHECK(parser.first_page_ready());
+    CHECK(parser.objects().get(objref(3, 0)).object.is_string("(second page)"));
+    CHECK(parser.objects().get(objref(13, 0)).object.is_string("(first page)"));
+}
+
+TEST_CASE("progressive_parser: not linearized", "[linearized]") {
+    // without the linearization dictionary, nothing can be loaded until the end
+    auto pdf = linearized_pdf();
+    auto begin = pdf.find("10 0 obj"), end = pdf.find("11 0 obj");
+    pdf.replace(begin, end - begin, std::string(end - begin, ' '));
+    growing_source source;
+    progressive_parser parser(source);
+    source.append(to_slice(pdf.substr(0, pdf.size() - 1)));
+    CHECK(!parser.first_page_ready());
+    CHECK(!parser.linearized());
+    CHECK_THROWS(parser.objects());
+    source.append(to_slice(pdf.substr(pdf.size() - 1)));
+    source.close();
+    REQUIRE(parser.ready());
+    CHECK(parser.first_page_ready());
+    CHECK(parser.objects().get(objref(12, 0)).object.is_dict());
+    CHECK(parser.objects().get(objref(3, 0)).object.is_string("(second page)"));
+}
+
+TEST_CASE("progressive_parser: updated after linearization", "[linearized]") {
+    // an incremental update makes /L wrong, so the file is loaded like any other
+    auto pdf = linearized_pdf();
+    pdf += "3 0 obj\n(updated)\nendobj\n";
+    auto xref = pdf.size();
+    pdf += "xref\n3 1\n" + entry(xref - 25) + "trailer\n<</Size 14 /Root 11 0 R /Prev " +
+        std::to_string(pdf.find("xref\n10 4")) + ">>\nstartxref\n" + std::to_string(xref) + "\n%%EOF\n";
+    growing_source source;
+    progressive_parser parser(source);
+    source.append(to_slice(pdf));
+    CHECK(!parser.first_page_ready());
+    source.close();
+    REQUIRE(parser.ready());
+    CHECK(!parser.linearized());
+    CHECK(parser.objects().get(objref(3, 0)).object.is_string("(updated)"));
+    CHECK(parser.objects().get(objref(13, 0)).object.is_string("(first page)"));
+}
@@ -0,0 +1,103 @@
+#include "catch.hpp"
+#include "test_tools.hpp"
+#include "byte_source.hpp"
+#include "object_loader.hpp"
+#include "range_planner.hpp"
+#include "xref_table.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using pdf::byte_extent;
+using pdf::range_planner;
+using pdf::tools::objref;
+using pdf::tools::slice;
+
+namespace {
+
+    /*
+        Objects 1 to 99, with the catalog (1) and information dictionary (50) far apart,
+        and a page of 1000 bytes in between each of them.
+    */
+    auto make_pdf() -> std::string {
+        std::string pdf = "%PDF-1.4\n";
+        std::vector<std::size_t> offsets;
+        for (int id = 1; id < 100; ++id) {
+            offsets.push_back(pdf.size());
+            pdf += std::to_string(id) + " 0 obj\n(" + std::string(1000, 'a' + id % 26) + ")\nendobj\n";
+        }
+        auto xref = pdf.size();
+        pdf += "xref\n0 100\n0000000000 65535 f\r\n";
+        char entry[21];
+        for (auto offset : offsets) {
+            snprintf(entry, sizeof entry, "%010zu 00000 n\r\n", offset);
+            pdf += entry;
+        }
+        pdf += "trailer\n<</Size 100 /Root 1 0 R /Info 50 0 R>>\nstartxref\n" + std::to_string(xref) + "\n%%EOF\n";
+        return pdf;
+    }
+
+}
+
+TEST_CASE("coalesce", "[planner]") {
+    auto merged = pdf::coalesce({ byte_extent(100, 10), byte_extent(0, 10), byte_extent(105, 20), byte_extent(200, 0),
+                                  byte_extent(130, 5) });
+    REQUIRE(merged.size() == 3);
+    CHECK(merged[0].offset == 0);
+    CHECK(merged[1].offset == 100);
+    CHECK(merged[1].length == 25);
+    CHECK(merged[2].offset == 130);
+    // bridge gaps of up to 10 bytes
+    merged = pdf::coalesce(merged, 10);
+    REQUIRE(merged.size() == 2);
+    CHECK(merged[1].offset == 100);
+    CHECK(merged[1].length == 35);
+    CHECK(pdf::total_length(merged) == 45);
+}
+
+TEST_CASE("range_planner: objects", "[planner]") {
+    auto pdf = make_pdf();
+    pdf::xref_table xref(to_slice(pdf));
+    xref.load();
+    range_planner plan(xref, pdf.size(), 0);
+
+    auto one = plan.extent(objref(7, 0));
+    CHECK(one.offset == pdf.find("7 0 obj"));
+    CHECK(one.length == pdf.find("8 0 obj") - pdf.find("7 0 obj"));
+    CHECK(plan.extent(objref(0, 0)).length == 0);
+    CHECK(plan.extent(objref(1000, 0)).length == 0);
+    // the last object ends at the trailer
+    auto last = plan.extent(objref(99, 0));
+    CHECK(last.length <= pdf.find("trailer") - last.offset);
+
+    // neighbours are fetched together, however they are asked for
+    auto extents = plan.objects({ objref(9, 0), objref(7, 0), objref(8, 0), objref(20, 0), objref(0, 0) });
+    REQUIRE(extents.size() == 2);
+    CHECK(extents[0].offset == one.offset);
+    CHECK(extents[1].offset == pdf.find("20 0 obj"));
+
+    // unless the gap is larger than allowed
+    range_planner gaps(xref, pdf.size(), 5000);
+    CHECK(gaps.objects({ objref(7, 0), objref(9, 0) }).size() == 1);
+    CHECK(gaps.objects({ objref(7, 0), objref(20, 0) }).size() == 2);
+}
+
+TEST_CASE("range_planner: metadata", "[planner]") {
+    auto pdf = make_pdf();
+    pdf::xref_table xref(to_slice(pdf));
+    xref.load();
+    range_planner plan(xref, pdf.size());
+    auto extents = plan.metadata();
+    REQUIRE(extents.size() == 2);
+    CHECK(pdf::total_length(extents) < 2100);
+
+    // fetching only the planned ranges is enough to load the objects
+    std::string fetched(pdf.size(), '\0');
+    for (const auto& extent : extents)
+        fetched.replace(extent.offset, extent.length, pdf, extent.offset, extent.length);
+    pdf::object_loader objects(to_slice(fetched), xref);
+    CHECK(objects.get(objref(1, 0)).object.get_string().length() == 1002);
+    CHECK(objects.get(objref(50, 0)).object.get_string().length() == 1002);
+    CHECK_THROWS(objects.get(objref(2, 0)));
+}
@@ -37,6 +37,14 @@ TEST_CASE("slice: left", "[slice]") {
     CHECK(s.left(6) == "xyzzy");
 }
 
+TEST_CASE("slice: right", "[slice]") {
+    slice s("xyzzy");
+    CHECK(s.right(0) == "");
+    CHECK(s.right(2) == "zy");
+    CHECK(s.right(5) == "xyzzy");
+    CHECK(s.right(6) == "xyzzy");
+}
+
 TEST_CASE("slice: remove_left", "[slice]") {
     slice s("xyzzy");
     CHECK(s.remove_left(0) == "xyzzy");
@@ -144,4 +152,19 @@ TEST_CASE("slice: find_last", "[slice]") {
     CHECK(slice("hic haec hoc").find_last("hoc") == "hoc");
     CHECK(slice("hic haec hoc").find_last("haec") == "haec hoc");
     CHECK(slice("hic haec hic hoc").find_last("hic") == "hic hoc");
-}
\ No newline at end of file
+    CHECK(slice("hic").find_last("hic") == "hic");
+    CHECK(slice("hi").find_last("hic").empty());
+    CHECK(slice("").find_last("hic").empty());
+    CHECK(slice("hic hic").find_last("").empty());
+}
+
+TEST_CASE("slice: find_first", "[slice]") {
+    CHECK(slice("hic haec hoc").find_first("huic").empty());
+    CHECK(slice("hic haec hoc").find_first("hoc") == "hoc");
+    CHECK(slice("hic haec hoc").find_first("haec") == "haec hoc");
+    CHECK(slice("hic haec hic hoc").find_first("hic") == "hic haec hic hoc");
+    CHECK(slice("hic haec hic hoc").find_first("c h") == "c haec hic hoc");
+    CHECK(slice("hic").find_first("hic") == "hic");
+    CHECK(slice("hi").find_first("hic").empty());
+    CHECK(slice("").find_first("hic").empty());
+}
@@ -0,0 +1,138 @@
+#include "catch.hpp"
+#include "stream_cache.hpp"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+using pdf::objref;
+using pdf::stream_cache;
+
+namespace {
+
+    auto bytes(std::size_t length, char c) -> std::vector<char> {
+        return std::vector<char>(length, c);
+    }
+
+    auto compress_string(const std::string& s) -> std::string {
+        std::string result(compressBound(s.size()), '\0');
+        uLongf length = result.size();
+        compress(reinterpret_cast<Bytef*>(&result[0]), &length, reinterpret_cast<const Bytef*>(s.data()), s.size());
+        result.resize(length);
+        return result;
+    }
+
+}
+
+TEST_CASE("stream_cache: least recently used eviction", "[stream_cache]") {
+    stream_cache cache(300);
+    cache.insert(objref(1), bytes(100, 'a'));
+    cache.insert(objref(2), bytes(100, 'b'));
+    cache.insert(objref(3), bytes(100, 'c'));
+    CHECK(cache.size() == 300);
+
+    // using 1 makes 2 the least recently used
+    CHECK(cache.get(objref(1))->at(0) == 'a');
+    cache.insert(objref(4), bytes(100, 'd'));
+    CHECK(cache.size() == 300);
+    CHECK(!cache.get(objref(2)));
+    CHECK(cache.get(objref(1)));
+    CHECK(cache.get(objref(3)));
+    CHECK(cache.get(objref(4)));
+
+    // generations are different objects
+    CHECK(!cache.get(objref(1, 1)));
+
+    auto stats = cache.stats();
+    CHECK(stats.hits == 4);
+    CHECK(stats.misses == 2);
+    CHECK(stats.evictions == 1);
+
+    // too large to keep, but still returned
+    auto large = cache.insert(objref(5), bytes(301, 'e'));
+    CHECK(large->size() == 301);
+    CHECK(!cache.get(objref(5)));
+    CHECK(cache.size() == 300);
+
+    cache.erase(objref(4));
+    CHECK(cache.size() == 200);
+    CHECK(!cache.get(objref(4)));
+}
+
+TEST_CASE("stream_cache: pinned data", "[stream_cache]") {
+    stream_cache cache(200);
+    auto pinned = cache.insert(objref(1), bytes(100, 'a'));
+    cache.insert(objref(2), bytes(100, 'b'));
+
+    // 1 is the least recently used, but is held, so 2 goes instead
+    cache.insert(objref(3), bytes(100, 'c'));
+    CHECK(cache.get(objref(1)));
+    CHECK(!cache.get(objref(2)));
+
+    // with everything held, the cache goes over budget rather than drop data in use
+    auto held = cache.get(objref(3));
+    auto more = cache.insert(objref(4), bytes(100, 'd'));
+    CHECK(cache.size() == 300);
+
+    // once released, it is evicted again
+    pinned.reset();
+    held.reset();
+    more.reset();
+    cache.insert(objref(5), bytes(100, 'e'));
+    CHECK(cache.size() == 200);
+
+    // erased data stays valid for whoever holds it
+    auto kept = cache.get(objref(5));
+    cache.erase(objref(5));
+    CHECK(kept->at(99) == 'e');
+}
+
+TEST_CASE("stream_cache: decoding on a miss", "[stream_cache]") {
+    pdf::atom_table t;
+    std::string text(10000, 'x');
+    auto compressed = compress_string(text);
+    auto dict = *pdf::parser("<</Filter /FlateDecode>>", t).next_object();
+    pdf::indirect_object object(objref(7), dict, pdf::tools::slice(compressed.data(), compressed.size()));
+
+    stream_cache cache(1 << 20);
+    auto first = cache.get(object);
+    auto second = cache.get(object);
+    CHECK(first == second);
+    CHECK(std::string(first->begin(), first->end()) == text);
+    CHECK(cache.stats().misses == 1);
+    CHECK(cache.stats().hits == 1);
+
+    int decoded = 0;
+    auto decode = [&] { ++decoded; return bytes(10, 'z'); };
+    cache.get(objref(8), decode);
+    cache.get(objref(8), decode);
+    CHECK(decoded == 1);
+
+    CHECK_THROWS(cache.get(pdf::indirect_object(objref(9), dict)));
+}
+
+TEST_CASE("stream_cache: concurrent use", "[stream_cache]") {
+    stream_cache cache(10000);
+    std::atomic<bool> wrong{ false };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 2000; ++i) {
+                auto id = (i * 7 + t) % 300;
+                auto data = cache.get(objref(id), [id] { return bytes(100, static_cast<char>(id)); });
+                if (data->size() != 100 || data->at(50) != static_cast<char>(id))
+                    wrong = true;
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    CHECK(!wrong);
+    CHECK(cache.size() <= 10000);
+    auto stats = cache.stats();
+    auto lookups = stats.hits + stats.misses;
+    CHECK(lookups == 8000);
+    CHECK(stats.evictions > 0);
+}
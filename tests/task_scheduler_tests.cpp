@@ -0,0 +1,113 @@
+#include "catch.hpp"
+#include "test_tools.hpp"
+#include "parallel_decode.hpp"
+#include "tools/task_scheduler.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+using pdf::tools::slice;
+using pdf::tools::task_scheduler;
+
+namespace {
+
+    auto compress_string(const std::string& s) -> std::string {
+        std::string result(compressBound(s.size()), '\0');
+        uLongf length = result.size();
+        compress(reinterpret_cast<Bytef*>(&result[0]), &length, reinterpret_cast<const Bytef*>(s.data()), s.size());
+        result.resize(length);
+        return result;
+    }
+
+}
+
+TEST_CASE("task_scheduler: submit", "[task_scheduler]") {
+    task_scheduler scheduler(3);
+    CHECK(scheduler.size() == 3);
+    std::vector<std::future<unsigned>> results;
+    for (unsigned i = 0; i < 100; ++i)
+        results.push_back(scheduler.submit([i](unsigned worker) { return worker < 3 ? i * i : 0; }));
+    for (unsigned i = 0; i < 100; ++i)
+        CHECK(results[i].get() == i * i);
+
+    auto failed = scheduler.submit([](unsigned) -> int { throw std::runtime_error("failed"); });
+    CHECK_THROWS(failed.get());
+}
+
+TEST_CASE("task_scheduler: for_each", "[task_scheduler]") {
+    for (unsigned threads : { 1, 2, 5 }) {
+        task_scheduler scheduler(threads);
+        std::vector<int> counts(1000);
+        std::atomic<bool> bad_worker{ false };
+        scheduler.for_each(counts.size(), [&](std::size_t i, unsigned worker) {
+            ++counts[i];
+            if (worker >= threads)
+                bad_worker = true;
+        });
+        INFO(threads << " threads");
+        CHECK(std::count(counts.begin(), counts.end(), 1) == 1000);
+        CHECK(!bad_worker);
+        scheduler.for_each(0, [](std::size_t, unsigned) {});
+    }
+}
+
+TEST_CASE("task_scheduler: uneven work is shared", "[task_scheduler]") {
+    // the first task is long, so the others must be stolen from the queue it split into
+    task_scheduler scheduler(2);
+    std::vector<unsigned> workers(64);
+    scheduler.for_each(workers.size(), [&](std::size_t i, unsigned worker) {
+        if (i == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        workers[i] = worker;
+    });
+    CHECK(std::count(workers.begin() + 1, workers.end(), workers[0]) < 63);
+}
+
+TEST_CASE("task_scheduler: for_each errors", "[task_scheduler]") {
+    task_scheduler scheduler(4);
+    std::atomic<int> done{ 0 };
+    CHECK_THROWS(scheduler.for_each(100, [&](std::size_t i, unsigned) {
+        if (i % 10 == 3)
+            throw std::runtime_error("failed");
+        ++done;
+    }));
+    // the others still all ran
+    CHECK(done == 90);
+}
+
+TEST_CASE("decode_streams: concurrent decoding", "[task_scheduler]") {
+    pdf::atom_table t;
+    auto flate = *pdf::parser("<</Filter /FlateDecode>>", t).next_object();
+    auto unsupported = *pdf::parser("<</Filter /JBIG2Decode>>", t).next_object();
+
+    std::vector<std::string> texts, encoded;
+    for (int i = 0; i < 200; ++i) {
+        std::string text;
+        for (int j = 0; j < i * 20; ++j)
+            text += "BT /F1 12 Tf 72 " + std::to_string(j) + " Td (" + std::to_string(i) + ") Tj ET\n";
+        texts.push_back(text);
+        encoded.push_back(compress_string(text));
+    }
+    std::vector<pdf::indirect_object> objects;
+    for (int i = 0; i < 200; ++i)
+        objects.emplace_back(pdf::objref(i + 1), flate, to_slice(encoded[i]));
+    objects.emplace_back(pdf::objref(201), flate);
+    objects.emplace_back(pdf::objref(202), unsupported, to_slice(encoded[5]));
+
+    task_scheduler scheduler(4);
+    auto decoded = pdf::decode_streams(objects, scheduler);
+    REQUIRE(decoded.data.size() == objects.size());
+    CHECK(decoded.arenas.size() == 4);
+    for (int i = 0; i < 200; ++i) {
+        INFO("stream " << i);
+        CHECK(std::string(decoded.data[i].begin(), decoded.data[i].end()) == texts[i]);
+        CHECK(!decoded.errors[i]);
+    }
+    CHECK(decoded.data[200].empty());
+    CHECK(!decoded.errors[200]);
+    CHECK(decoded.errors[201]);
+}
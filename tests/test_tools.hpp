@@ -0,0 +1,35 @@
+#ifndef TEST_TOOLS_HPP
+#define TEST_TOOLS_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "byte_source.hpp"
+#include "tools.hpp"
+
+namespace {
+
+    // the string has to outlive the slice
+    inline auto to_slice(const std::string& s) -> pdf::tools::slice {
+        return pdf::tools::slice(s.data(), s.data() + s.size());
+    }
+
+    // counts the bytes read, and isn't in memory, so windows are read as they grow
+    class counting_source : public pdf::byte_source {
+    public:
+        counting_source(pdf::tools::slice input) : input(input) {}
+        auto size() const noexcept -> std::uint64_t override { return input.size(); }
+        auto read(std::uint64_t offset, std::size_t length) const -> pdf::byte_range override {
+            auto range = input.read(offset, length);
+            bytes_read += range.data.length();
+            return range;
+        }
+        mutable std::uint64_t bytes_read = 0;
+
+    private:
+        pdf::memory_source input;
+    };
+
+}
+
+#endif
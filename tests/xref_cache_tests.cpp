@@ -0,0 +1,203 @@
+#include "catch.hpp"
+#include "test_tools.hpp"
+#include "tools.hpp"
+#include "pdf_dictionaries.hpp"
+#include "xref_cache.hpp"
+#include "xref_table.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using pdf::tools::slice;
+using pdf::xref_cache_key;
+using pdf::xref_table;
+using pdf::xref_type;
+
+namespace {
+
+    const std::string cache = std::string(P_tmpdir) + "/pdfp_xref_cache_tests.xref";
+
+    auto make_key() -> xref_cache_key {
+        xref_cache_key key;
+        key.size = 2000000000;
+        key.mtime = 1234567890;
+        key.tail_hash = 0x0123456789abcdef;
+        return key;
+    }
+
+}
+
+TEST_CASE("xref_cache: round trip", "[xref_cache]") {
+    std::string pdf =
+        "%PDF-1.4\n"
+        "xref\n"
+        "0 3\n"
+        "0000000000 65535 f\r\n"
+        "0000000017 00000 n\r\n"
+        "1234567890 00002 n\r\n"
+        "2000 1\n"
+        "0000000999 00001 n\r\n"
+        "trailer\n<</Size 2001>>\n";
+    xref_table xref(to_slice(pdf));
+    xref.get_from(9);
+    auto key = make_key();
+    pdf::save_xref_cache(cache, key, xref);
+
+    xref_table restored(to_slice(pdf));
+    REQUIRE(pdf::load_xref_cache(cache, key, restored));
+    CHECK(restored.size() == 2001);
+    CHECK(!restored[0].in_use());
+    CHECK(restored[0].gen() == 65535);
+    CHECK(restored[1].offset() == 17);
+    CHECK(restored[2].offset() == 1234567890);
+    CHECK(restored[2].gen() == 2);
+    CHECK(!restored[1000].in_use());
+    CHECK(restored[2000].offset() == 999);
+    CHECK(restored.trailer_offset() == xref.trailer_offset());
+    CHECK(pdf::trailer_dict(restored.trailer()).Size() == 2001);
+    // the empty pages in between aren't stored, and the others aren't copied
+    CHECK(restored.memory() < xref.memory());
+
+    SECTION("stale") {
+        xref_table other(to_slice(pdf));
+        key.tail_hash ^= 1;
+        CHECK(!pdf::load_xref_cache(cache, key, other));
+        key = make_key();
+        key.mtime += 1;
+        CHECK(!pdf::load_xref_cache(cache, key, other));
+    }
+
+    SECTION("damaged") {
+        std::string contents;
+        {
+            std::ifstream file(cache, std::ios::binary);
+            contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        {
+            std::ofstream file(cache, std::ios::binary | std::ios::trunc);
+            file.write(contents.data(), contents.size() - 8);
+        }
+        xref_table other(to_slice(pdf));
+        CHECK(!pdf::load_xref_cache(cache, key, other));
+        std::remove(cache.c_str());
+        CHECK(!pdf::load_xref_cache(cache, key, other));
+    }
+
+    SECTION("invalid entries") {
+        std::string contents;
+        {
+            std::ifstream file(cache, std::ios::binary);
+            contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        // entry 1 of the first page, after the header and the page number
+        auto entry = 11 * 8 + 8 + 8;
+        auto write = [&](std::uint64_t bits) {
+            auto damaged = contents;
+            std::copy_n(reinterpret_cast<const char*>(&bits), 8, &damaged[entry]);
+            std::ofstream file(cache, std::ios::binary | std::ios::trunc);
+            file.write(damaged.data(), damaged.size());
+        };
+        xref_table other(to_slice(pdf));
+        write(pdf::xref_entry(17, 0, xref_type::in_use).raw());
+        CHECK(pdf::load_xref_cache(cache, key, other));
+        write(pdf::xref_entry(17, 0, xref_type::in_use).raw() | std::uint64_t(3) << 56);
+        CHECK(!pdf::load_xref_cache(cache, key, other));
+        write(pdf::xref_entry(key.size, 0, xref_type::in_use).raw());
+        CHECK(!pdf::load_xref_cache(cache, key, other));
+        write(pdf::xref_entry(5000, 0, xref_type::compressed).raw());
+        CHECK(!pdf::load_xref_cache(cache, key, other));
+    }
+
+    std::remove(cache.c_str());
+}
+
+TEST_CASE("xref_cache: borrowed pages", "[xref_cache]") {
+    // a borrowed page is copied before an entry in it is set, leaving the original alone
+    std::vector<pdf::xref_entry> page(pdf::xref_entries::page_size, pdf::xref_entry(17, 0, xref_type::in_use));
+    auto memory = std::make_shared<int>(0);
+    pdf::xref_entries entries;
+    entries.resize(2000);
+    entries.borrow_page(1, page.data(), memory);
+    CHECK(memory.use_count() == 2);
+    CHECK(entries[1024].offset() == 17);
+    CHECK(entries.memory() < pdf::xref_entries::page_size * sizeof(pdf::xref_entry));
+
+    entries.set(1025, pdf::xref_entry(23, 0, xref_type::in_use));
+    CHECK(entries[1024].offset() == 17);
+    CHECK(entries[1025].offset() == 23);
+    CHECK(page[1].offset() == 17);
+    CHECK(entries.memory() > pdf::xref_entries::page_size * sizeof(pdf::xref_entry));
+    CHECK_THROWS(entries.borrow_page(2, page.data(), memory));
+    entries.clear();
+    CHECK(memory.use_count() == 1);
+}
+
+TEST_CASE("xref_cache: reconstructed table", "[xref_cache]") {
+    std::string pdf =
+        "%PDF-1.4\n"
+        "1 0 obj\n<</Type /Pages /Kids [] /Count 0>>\nendobj\n"
+        "7 0 obj\n<</Type /Catalog /Pages 1 0 R>>\nendobj\n"
+        "2 0 obj\n(trunc";
+    xref_table xref(to_slice(pdf));
+    xref.reconstruct();
+    auto key = make_key();
+    pdf::save_xref_cache(cache, key, xref);
+
+    xref_table restored(to_slice(pdf));
+    REQUIRE(pdf::load_xref_cache(cache, key, restored));
+    std::remove(cache.c_str());
+    CHECK(restored.reconstructed());
+    CHECK(restored.size() == 8);
+    CHECK(restored[7].type() == xref_type::in_use);
+    CHECK(restored[7].offset() == xref[7].offset());
+    CHECK(pdf::trailer_dict(restored.trailer()).Size() == 8);
+    CHECK(restored.trailer()[pdf::names::Root].is_ref(7, 0));
+}
+
+TEST_CASE("xref_cache: concurrent saves", "[xref_cache]") {
+    std::string pdf =
+        "%PDF-1.4\n"
+        "xref\n"
+        "0 2\n"
+        "0000000000 65535 f\r\n"
+        "0000000017 00000 n\r\n"
+        "trailer\n<</Size 2>>\n";
+    xref_table xref(to_slice(pdf));
+    xref.get_from(9);
+    auto key = make_key();
+
+    // each save writes a file of its own, so whichever is renamed last is whole
+    std::vector<std::thread> savers;
+    for (int i = 0; i < 4; ++i)
+        savers.emplace_back([&] {
+            for (int n = 0; n < 20; ++n)
+                pdf::save_xref_cache(cache, key, xref);
+        });
+    for (auto& saver : savers)
+        saver.join();
+
+    xref_table restored(to_slice(pdf));
+    REQUIRE(pdf::load_xref_cache(cache, key, restored));
+    std::remove(cache.c_str());
+    CHECK(restored[1].offset() == 17);
+
+    CHECK_THROWS(pdf::save_xref_cache(cache + ".missing/cache.xref", key, xref));
+}
+
+TEST_CASE("xref_cache: key", "[xref_cache]") {
+    const std::string filename = std::string(P_tmpdir) + "/pdfp_xref_cache_tests.pdf";
+    std::string pdf = "%PDF-1.4\n%%EOF\n";
+    std::ofstream(filename) << pdf;
+    auto key = pdf::make_xref_cache_key(filename, pdf::memory_source(to_slice(pdf)));
+    CHECK(key.size == pdf.size());
+    std::string changed = "%PDF-1.4\n%%EOX\n";
+    auto other = pdf::make_xref_cache_key(filename, pdf::memory_source(to_slice(changed)));
+    CHECK(other.mtime == key.mtime);
+    CHECK(other.tail_hash != key.tail_hash);
+    std::remove(filename.c_str());
+    CHECK_THROWS(pdf::make_xref_cache_key(filename, pdf::memory_source(to_slice(pdf))));
+}
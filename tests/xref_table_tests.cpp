@@ -0,0 +1,418 @@
+#include "catch.hpp"
+#include "test_tools.hpp"
+#include "tools.hpp"
+#include "pdf_dictionaries.hpp"
+#include "xref_scanner.hpp"
+#include "xref_table.hpp"
+
+#include <zlib.h>
+
+#include <cstdio>
+#include <string>
+
+using pdf::tools::slice;
+using pdf::xref_table;
+using pdf::xref_type;
+
+TEST_CASE("xref_table: classic", "[xref]") {
+    slice pdf(
+        "xref\n"
+        "0 3\n"
+        "0000000000 65535 f\r\n"
+        "0000000017 00000 n\r\n"
+        "1234567890 00002 n \n"
+        "5 1\n"
+        "0000000999 00001 f \r"
+        "trailer\n<</Size 6>>\n");
+    xref_table xref(pdf);
+    xref.get_from(0);
+    CHECK(xref.size() == 6);
+    CHECK(xref[0].type() == xref_type::free);
+    CHECK(xref[0].gen() == 65535);
+    CHECK(xref[1].in_use());
+    CHECK(xref[1].offset() == 17);
+    CHECK(xref[1].gen() == 0);
+    CHECK(xref[2].in_use());
+    CHECK(xref[2].offset() == 1234567890);
+    CHECK(xref[2].gen() == 2);
+    CHECK(!xref[3].in_use());
+    CHECK(xref[5].type() == xref_type::free);
+    CHECK(xref[5].offset() == 999);
+    CHECK(xref[5].gen() == 1);
+    CHECK(!xref[100].in_use());
+}
+
+TEST_CASE("xref_table: malformed entries", "[xref]") {
+    slice pdf(
+        "%PDF-1.4 junk\n"
+        "xref\r\n"
+        "0 4 \r\n"
+        "0000000000 65535 f\r\n"
+        "17 0 n\n"
+        "0000000042 00000 n\n"
+        "0000000099 00003 n\r\n"
+        "trailer\n<</Size 4>>\n");
+    xref_table xref(pdf);
+    xref.get_from(14);
+    CHECK(xref[1].offset() == 17);
+    CHECK(xref[2].offset() == 42);
+    CHECK(xref[3].offset() == 99);
+    CHECK(xref[3].gen() == 3);
+    CHECK(xref[3].in_use());
+}
+
+TEST_CASE("xref_table: newer sections override older ones", "[xref]") {
+    slice pdf(
+        "xref\n0 3\n"
+        "0000000000 65535 f\r\n"
+        "0000000010 00000 n\r\n"
+        "0000000020 00000 n\r\n"
+        "trailer\n<</Size 3>>\n"
+        "xref\n2 1\n"
+        "0000000030 00001 n\r\n"
+        "trailer\n<</Size 3 /Prev 0>>\n"
+        "xref\n1 1\n"
+        "0000000040 00000 f\r\n"
+        "trailer\n<</Size 3 /Prev 89>>\n");
+    xref_table xref(pdf);
+    xref.get_from(146);
+    CHECK(!xref[1].in_use());
+    CHECK(xref[1].offset() == 40);
+    CHECK(xref[2].in_use());
+    CHECK(xref[2].offset() == 30);
+    CHECK(xref[2].gen() == 1);
+    CHECK(pdf::trailer_dict(xref.trailer()).Prev() == 89);
+}
+
+TEST_CASE("xref_table: /Prev cycles", "[xref]") {
+    slice pdf(
+        "%PDF-1.4\n"
+        "xref\n1 1\n"
+        "0000000010 00000 n\r\n"
+        "trailer\n<</Size 3 /Prev 67>>\n"
+        "xref\n2 1\n"
+        "0000000020 00000 n\r\n"
+        "trailer\n<</Size 3 /Prev 9>>\n");
+    xref_table xref(pdf);
+    xref.get_from(67);
+    CHECK(xref[1].offset() == 10);
+    CHECK(xref[2].offset() == 20);
+}
+
+TEST_CASE("xref_table: many incremental updates", "[xref]") {
+    // enough sections to be decoded concurrently
+    std::string pdf;
+    int prev = 0;
+    for (int i = 1; i <= 200; ++i) {
+        int offset = pdf.size();
+        char entry[21];
+        std::snprintf(entry, sizeof entry, "%010d %05d n\r\n", i * 100, i % 3);
+        pdf += "xref\n0 1\n0000000000 65535 f\r\n";
+        pdf += std::to_string((i - 1) % 50 + 1) + " 1\n" + entry;
+        pdf += "trailer\n<</Size 51";
+        if (i > 1)
+            pdf += " /Prev " + std::to_string(prev);
+        pdf += ">>\n";
+        prev = offset;
+    }
+    xref_table xref(slice(pdf.data(), pdf.data() + pdf.size()));
+    xref.get_from(prev);
+    for (unsigned id = 1; id <= 50; ++id) {
+        // the last update of object id is revision 150 + id
+        CHECK(xref[id].offset() == (150 + id) * 100);
+        CHECK(xref[id].gen() == (150 + id) % 3);
+    }
+}
+
+TEST_CASE("xref_table: errors", "[xref]") {
+    slice pdf("xref\n0 2\n0000000000 65535 f\r\n0000000010 00000 x\r\ntrailer\n<</Size 2>>");
+    xref_table xref(pdf);
+    CHECK_THROWS(xref.get_from(1));
+    CHECK_THROWS(xref.get_from(1000));
+    CHECK_THROWS(xref.get_from(0));
+
+    slice no_size("xref\n0 1\n0000000000 65535 f\r\ntrailer\n<<>>");
+    CHECK_THROWS(xref_table(no_size).get_from(0));
+}
+
+namespace {
+
+    // append an xref stream row with field widths [1 2 1]
+    void row(std::string& rows, int type, int offset, int gen) {
+        rows += static_cast<char>(type);
+        rows += static_cast<char>(offset >> 8);
+        rows += static_cast<char>(offset);
+        rows += static_cast<char>(gen);
+    }
+
+    auto xref_stream(const std::string& dict, const std::string& data) -> std::string {
+        return "<<" + dict + " /Length " + std::to_string(data.size()) + ">>\nstream\n" + data + "\nendstream\nendobj\n";
+    }
+
+}
+
+TEST_CASE("xref_table: xref stream", "[xref]") {
+    std::string rows;
+    row(rows, 0, 0, 255);
+    row(rows, 1, 15, 0);
+    row(rows, 1, 0x1234, 1);
+    row(rows, 2, 9, 0);
+    row(rows, 1, 300, 0);
+    std::string pdf = "%PDF-1.5\n9 0 obj\n" +
+        xref_stream("/Type /XRef /Size 11 /W [1 2 1] /Index [0 3 9 2]", rows);
+    xref_table xref(to_slice(pdf));
+    xref.get_from(9);
+    CHECK(!xref[0].in_use());
+    CHECK(xref[1].in_use());
+    CHECK(xref[1].offset() == 15);
+    CHECK(xref[2].offset() == 0x1234);
+    CHECK(xref[2].gen() == 1);
+    CHECK(xref[9].type() == xref_type::compressed);
+    CHECK(xref[9].stream() == 9);
+    CHECK(xref[9].index() == 0);
+    CHECK(xref[10].in_use());
+    CHECK(xref[10].offset() == 300);
+    CHECK(pdf::trailer_dict(xref.trailer()).Size() == 11);
+}
+
+TEST_CASE("xref_table: xref stream with generic field widths", "[xref]") {
+    // no type field (defaults to 1) and no generation field (defaults to 0)
+    std::string rows("\x00\x00\x10\x00\x01\x00", 6);
+    std::string pdf = "%PDF-1.5\n1 0 obj\n" + xref_stream("/Type /XRef /Size 2 /W [0 3 0]", rows);
+    xref_table xref(to_slice(pdf));
+    xref.get_from(9);
+    CHECK(xref[0].in_use());
+    CHECK(xref[0].offset() == 16);
+    CHECK(xref[1].offset() == 256);
+    CHECK(xref[1].gen() == 0);
+}
+
+TEST_CASE("xref_table: offsets beyond 4GB", "[xref]") {
+    std::string rows("\x01\x01\x23\x45\x67\x89\x00\x00", 8);
+    std::string pdf = "%PDF-1.5\n1 0 obj\n" + xref_stream("/Type /XRef /Size 1 /W [1 5 2]", rows);
+    xref_table xref(to_slice(pdf));
+    xref.get_from(9);
+    CHECK(xref[0].in_use());
+    CHECK(xref[0].offset() == 0x0123456789ull);
+    CHECK(xref[0].gen() == 0);
+
+    // entries which aren't laid out as the spec requires are read with the tokenizer
+    slice table(
+        "xref\n"
+        "0 2\n"
+        "0 65535 f\n"
+        "4294967313 0 n\n"
+        "trailer\n<</Size 2>>\n");
+    xref_table classic(table);
+    classic.get_from(0);
+    CHECK(classic[1].offset() == 4294967313ull);
+}
+
+TEST_CASE("xref_table: sparse storage", "[xref]") {
+    std::string rows;
+    row(rows, 1, 15, 0);
+    row(rows, 1, 300, 2);
+    std::string pdf = "%PDF-1.5\n1 0 obj\n" +
+        xref_stream("/Type /XRef /Size 8000000 /W [1 2 1] /Index [1 1 7999999 1]", rows);
+    xref_table xref(to_slice(pdf));
+    xref.get_from(9);
+    CHECK(xref.size() == 8000000);
+    CHECK(xref[1].offset() == 15);
+    CHECK(xref[7999999].offset() == 300);
+    CHECK(xref[7999999].gen() == 2);
+    CHECK(!xref[4000000].in_use());
+    // only the two pages holding entries are allocated
+    CHECK(xref.memory() < 1024 * 1024);
+}
+
+TEST_CASE("xref_table: compressed xref stream with predictor", "[xref]") {
+    // W [1 3 1], rows encoded with the PNG Up filter
+    unsigned char raw[4][5] = {
+        { 0, 0, 0, 0, 255 }, { 1, 0, 0, 15, 0 }, { 1, 0, 1, 0, 0 }, { 1, 1, 0, 0, 2 }
+    };
+    std::string predicted;
+    for (int r = 0; r < 4; ++r) {
+        predicted += '\x02';
+        for (int i = 0; i < 5; ++i)
+            predicted += static_cast<char>(raw[r][i] - (r == 0 ? 0 : raw[r - 1][i]));
+    }
+    std::string compressed(compressBound(predicted.size()), '\0');
+    uLongf length = compressed.size();
+    compress(reinterpret_cast<Bytef*>(&compressed[0]), &length,
+             reinterpret_cast<const Bytef*>(predicted.data()), predicted.size());
+    compressed.resize(length);
+
+    std::string pdf = "%PDF-1.5\n5 0 obj\n" + xref_stream(
+        "/Type /XRef /Size 4 /W [1 3 1] /Filter /FlateDecode /DecodeParms <</Predictor 12 /Columns 5>>",
+        compressed);
+    xref_table xref(to_slice(pdf));
+    xref.get_from(9);
+    CHECK(xref[1].offset() == 15);
+    CHECK(xref[2].offset() == 256);
+    CHECK(xref[3].offset() == 65536);
+    CHECK(xref[3].gen() == 2);
+}
+
+TEST_CASE("xref_table: hybrid reference file", "[xref]") {
+    std::string rows;
+    row(rows, 1, 70, 0);
+    row(rows, 0, 0, 0);
+    std::string pdf = "%PDF-1.5\n9 0 obj\n" + xref_stream("/Type /XRef /Size 4 /W [1 2 1] /Index [2 2]", rows);
+    std::size_t table = pdf.size();
+    pdf +=
+        "xref\n0 4\n"
+        "0000000000 65535 f\r\n"
+        "0000000010 00000 n\r\n"
+        "0000000000 00000 f\r\n"
+        "0000000030 00000 n\r\n"
+        "trailer\n<</Size 4 /XRefStm 9>>\n";
+    xref_table xref(to_slice(pdf));
+    xref.get_from(table);
+    CHECK(xref[1].offset() == 10);
+    // the xref stream supplies entries missing from the table, but doesn't delete any
+    CHECK(xref[2].in_use());
+    CHECK(xref[2].offset() == 70);
+    CHECK(xref[3].in_use());
+    CHECK(xref[3].offset() == 30);
+    CHECK(pdf::trailer_dict(xref.trailer()).XRefStm() == 9);
+}
+
+TEST_CASE("xref_table: hybrid reference file with conflicting entries", "[xref]") {
+    // an older update, and a hybrid update in which both the stream and table have object 1
+    std::string pdf = "%PDF-1.5\n";
+    std::size_t old = pdf.size();
+    pdf +=
+        "xref\n0 3\n"
+        "0000000000 65535 f\r\n"
+        "0000000011 00000 n\r\n"
+        "0000000022 00000 n\r\n"
+        "trailer\n<</Size 3>>\n";
+    std::string rows;
+    row(rows, 1, 70, 0);
+    row(rows, 2, 9, 0);
+    std::size_t stream = pdf.size();
+    pdf += "9 0 obj\n" + xref_stream("/Type /XRef /Size 3 /W [1 2 1] /Index [1 2]", rows);
+    std::size_t table = pdf.size();
+    pdf +=
+        "xref\n0 3\n"
+        "0000000000 65535 f\r\n"
+        "0000000030 00000 n\r\n"
+        "0000000000 00001 f\r\n"
+        "trailer\n<</Size 3 /XRefStm " + std::to_string(stream) + " /Prev " + std::to_string(old) + ">>\n";
+    xref_table xref(to_slice(pdf));
+    xref.get_from(table);
+    // the table's own in use entry takes precedence over the stream's
+    CHECK(xref[1].type() == xref_type::in_use);
+    CHECK(xref[1].offset() == 30);
+    // where the table has the object free, the stream supplies it, replacing the older update
+    CHECK(xref[2].type() == xref_type::compressed);
+    CHECK(xref[2].stream() == 9);
+}
+
+TEST_CASE("scan_objects: object headers", "[xref]") {
+    slice pdf(
+        "%PDF-1.4\n"
+        "1 0 obj\n<</Type /Catalog /Pages 2 0 R>>\nendobj\n"
+        "2  3\r\nobj<</Type /Pages>>endobj\n"
+        "x1 0 obj 10 0 objstm 4 obj 5 0 R obj\n"
+        "12 0 obj\n(trailer)\nendobj\n"
+        "1 0 obj\n<<>>\nendobj trailer");
+    pdf::tools::thread_pool pool(4);
+    auto scan = pdf::scan_objects(pdf, pool);
+    REQUIRE(scan.objects.size() == 4);
+    CHECK(scan.objects[0].id == 1);
+    CHECK(scan.objects[0].offset == 9);
+    CHECK(scan.objects[1].id == 2);
+    CHECK(scan.objects[1].gen == 3);
+    CHECK(scan.objects[2].id == 12);
+    CHECK(scan.objects[3].id == 1);
+    CHECK(scan.trailers.size() == 2);
+
+    // keywords split between chunks are found exactly once, whatever the chunk size
+    for (unsigned chunk_size = 1; chunk_size < 40; ++chunk_size) {
+        auto chunked = pdf::scan_objects(pdf, pool, chunk_size);
+        REQUIRE(chunked.objects.size() == scan.objects.size());
+        for (std::size_t i = 0; i < scan.objects.size(); ++i)
+            CHECK(chunked.objects[i].offset == scan.objects[i].offset);
+        CHECK(chunked.trailers == scan.trailers);
+    }
+}
+
+TEST_CASE("object_scanner: parts", "[xref]") {
+    std::string pdf =
+        "%PDF-1.4\n"
+        "1 0 obj\n<</Type /Catalog /Pages 2 0 R>>\nendobj\n"
+        "2  3\r\nobj<</Type /Pages>>endobj\n"
+        "x1 0 obj 10 0 objstm 4 obj 5 0 R obj\n" + std::string(200, ' ') +
+        "12              0                 obj\n(trailer)\nendobj\n"
+        "1 0 obj\n<<>>\nendobj trailer";
+    pdf::tools::thread_pool pool(4);
+    auto scan = pdf::scan_objects(slice(pdf.data(), pdf.size()), pool);
+    REQUIRE(scan.objects.size() == 4);
+
+    // the same things are found, however the file is split up
+    for (std::size_t part_size = 1; part_size < 100; ++part_size) {
+        pdf::object_scanner scanner;
+        for (std::size_t offset = 0; offset < pdf.size(); offset += part_size)
+            scanner.scan(slice(pdf.data() + offset, std::min(part_size, pdf.size() - offset)));
+        auto parts = scanner.finish();
+        REQUIRE(parts.objects.size() == scan.objects.size());
+        for (std::size_t i = 0; i < scan.objects.size(); ++i) {
+            CHECK(parts.objects[i].id == scan.objects[i].id);
+            CHECK(parts.objects[i].offset == scan.objects[i].offset);
+        }
+        CHECK(parts.trailers == scan.trailers);
+    }
+}
+
+TEST_CASE("xref_table: reconstruct", "[xref]") {
+    std::string pdf =
+        "%PDF-1.4\n"
+        "1 0 obj\n<</Type /Catalog /Pages 2 0 R>>\nendobj\n"
+        "2 0 obj\n<</Type /Pages /Kids [] /Count 0>>\nendobj\n"
+        "3 0 obj\n(first version)\nendobj\n"
+        "3 1 obj\n(second version)\nendobj\n"
+        "xref\n0 1\n0000000000 65535 f\r\n"
+        "trailer\n<</Size 4 /Root 1 0 R /Info 3 1 R>>\n"
+        "startxref\n9999";
+    xref_table xref(to_slice(pdf));
+    CHECK_THROWS(xref.get_from(9999));
+    xref.reconstruct();
+    CHECK(xref.size() == 4);
+    CHECK(xref[1].offset() == 9);
+    CHECK(xref[2].in_use());
+    CHECK(xref[3].offset() == pdf.find("3 1 obj"));
+    CHECK(xref[3].gen() == 1);
+    CHECK(xref.trailer()[pdf::names::Root].is_ref(1, 0));
+    CHECK(xref.trailer()[pdf::names::Info].is_ref(3, 1));
+}
+
+TEST_CASE("xref_table: reconstruct without a trailer", "[xref]") {
+    std::string pdf =
+        "%PDF-1.4\n"
+        "1 0 obj\n<</Type /Pages /Kids [] /Count 0>>\nendobj\n"
+        "7 0 obj\n<</Type /Catalog /Pages 1 0 R>>\nendobj\n"
+        "2 0 obj\n(trunc";
+    xref_table xref(to_slice(pdf));
+    xref.reconstruct();
+    CHECK(xref.size() == 8);
+    CHECK(xref[7].in_use());
+    CHECK(pdf::trailer_dict(xref.trailer()).Size() == 8);
+    CHECK(xref.trailer()[pdf::names::Root].is_ref(7, 0));
+
+    // only the objects which might be the catalog or object streams are read
+    std::string padding(10000, 'x');
+    for (int i = 8; i < 100; ++i)
+        pdf += "\n" + std::to_string(i) + " 0 obj\n(" + padding + ")\nendobj\n";
+    counting_source source(to_slice(pdf));
+    pdf::tools::thread_pool pool;
+    auto scan = pdf::scan_objects(to_slice(pdf), pool);
+    xref_table scanned(source);
+    scanned.reconstruct(scan);
+    CHECK(scanned.size() == 100);
+    CHECK(scanned.trailer()[pdf::names::Root].is_ref(7, 0));
+    CHECK(source.bytes_read < pdf.size() / 2);
+
+    xref_table empty(slice("%PDF-1.4\nnothing to see here"));
+    CHECK_THROWS(empty.reconstruct());
+}
@@ -0,0 +1,646 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "byte_source.hpp"
+#include "filter_pipeline.hpp"
+#include "filters.hpp"
+#include "object_loader.hpp"
+#include "parallel_decode.hpp"
+#include "parser.hpp"
+#include "mapped_file.hpp"
+#include "pdfp.hpp"
+#include "range_planner.hpp"
+#include "xref_table.hpp"
+
+namespace {
+
+    using namespace std;
+    using pdf::tools::slice;
+
+    auto to_slice(const string& s) -> slice {
+        return slice(s.data(), s.data() + s.size());
+    }
+
+    template <typename F>
+    auto time_ms(F f) -> double {
+        auto start = chrono::steady_clock::now();
+        f();
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+
+    /*
+        A classic xref table with `count` in use objects.
+    */
+    auto dense_table(unsigned count) -> string {
+        string pdf = "%PDF-1.4\n";
+        auto xref = pdf.size();
+        pdf += "xref\n0 " + to_string(count) + "\n";
+        char line[21];
+        for (unsigned i = 0; i < count; ++i) {
+            snprintf(line, sizeof line, "%010u 00000 n\r\n", 1000 + i * 16);
+            pdf += line;
+        }
+        pdf += "trailer\n<< /Size " + to_string(count) + " >>\nstartxref\n" + to_string(xref) + "\n%%EOF\n";
+        return pdf;
+    }
+
+    /*
+        An xref stream which declares a /Size of `size` but only has
+        `count` entries, spread evenly over the object number range.
+    */
+    auto sparse_stream(unsigned size, unsigned count) -> string {
+        string index, rows;
+        for (unsigned i = 0; i < count; ++i) {
+            auto id = 1 + static_cast<unsigned long long>(i) * (size - 2) / count;
+            index += " " + to_string(id) + " 1";
+            unsigned offset = 1000 + i * 16;
+            rows += '\x01';
+            rows += static_cast<char>(offset >> 24);
+            rows += static_cast<char>(offset >> 16);
+            rows += static_cast<char>(offset >> 8);
+            rows += static_cast<char>(offset);
+            rows += '\x00';
+        }
+        return "%PDF-1.5\n1 0 obj\n<</Type /XRef /Size " + to_string(size) + " /W [1 4 1] /Index [" + index +
+            "] /Length " + to_string(rows.size()) + ">>\nstream\n" + rows + "\nendstream\nendobj\n";
+    }
+
+    void report(const char* name, const pdf::xref_table& xref, double ms) {
+        // the unpacked layout used a padded 8 byte entry for every slot in /Size + 1
+        auto unpacked = (static_cast<size_t>(xref.size()) + 1) * 8;
+        cout << name << ": " << xref.size() << " entries, " << ms << " ms, "
+             << xref.memory() << " bytes (" << static_cast<double>(xref.memory()) / xref.size()
+             << " bytes/entry), unpacked layout: " << unpacked << " bytes" << endl;
+    }
+
+    void xref_memory(const vector<string>&) {
+        for (auto count : { 1000000u, 4000000u }) {
+            auto pdf = dense_table(count);
+            pdf::xref_table xref(to_slice(pdf));
+            auto ms = time_ms([&] { xref.get_from(9); });
+            report(("dense " + to_string(count)).c_str(), xref, ms);
+        }
+        for (auto count : { 1000u, 100000u }) {
+            auto pdf = sparse_stream(8000000, count);
+            pdf::xref_table xref(to_slice(pdf));
+            auto ms = time_ms([&] { xref.get_from(9); });
+            report(("sparse " + to_string(count) + "/8000000").c_str(), xref, ms);
+        }
+    }
+
+    /*
+        Opening a file with and without a warm xref cache.
+    */
+    void xref_cache(const vector<string>&) {
+        const string filename = string(P_tmpdir) + "/pdfp_bench.pdf";
+        const string cache = filename + ".xref";
+        auto pdf = dense_table(4000000);
+        {
+            ofstream file(filename, ios::binary);
+            file.write(pdf.data(), pdf.size());
+        }
+        remove(cache.c_str());
+        auto begin = pdf.data(), end = pdf.data() + pdf.size();
+        cout << "no cache: " << time_ms([&] { pdf::make_pdf_parser(begin, end); }) << " ms" << endl;
+        cout << "cold cache: " << time_ms([&] { pdf::make_pdf_parser(begin, end, filename, cache); }) << " ms" << endl;
+        cout << "warm cache: " << time_ms([&] { pdf::make_pdf_parser(begin, end, filename, cache); }) << " ms" << endl;
+        remove(cache.c_str());
+        remove(filename.c_str());
+    }
+
+    auto read_file(const string& filename) -> vector<char> {
+        ifstream file(filename, ios::binary);
+        if (!file.is_open())
+            throw runtime_error("failed to open file");
+        return vector<char>((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    }
+
+    /*
+        Open latency of a large file: reading it into memory as dump used to,
+        against mapping it. Uses the given file, or makes a 256 MB one.
+    */
+    void open(const vector<string>& args) {
+        string filename = args.empty() ? string(P_tmpdir) + "/pdfp_bench_large.pdf" : args[0];
+        if (args.empty()) {
+            ofstream file(filename, ios::binary);
+            string padding(1 << 20, ' ');
+            file << "%PDF-1.4\n1 0 obj\n<< /Length " << 256 * padding.size() << " >>\nstream\n";
+            for (int i = 0; i < 256; ++i)
+                file << padding;
+            auto xref = static_cast<long long>(file.tellp()) + 18;
+            file << "\nendstream\nendobj\nxref\n0 2\n0000000000 65535 f\r\n0000000009 00000 n\r\n"
+                 << "trailer\n<< /Size 2 >>\nstartxref\n" << xref << "\n%%EOF\n";
+        }
+
+        auto read = time_ms([&] {
+            auto pdf = read_file(filename);
+            pdf::make_pdf_parser(pdf.data(), pdf.data() + pdf.size());
+        });
+        cout << "read: " << read << " ms" << endl;
+        auto mapped = time_ms([&] {
+            pdf::mapped_file file(filename, pdf::access_pattern::random);
+            pdf::make_pdf_parser(file.data().begin(), file.data().end());
+        });
+        cout << "mapped: " << mapped << " ms" << endl;
+        auto populated = time_ms([&] {
+            pdf::mapped_file file(filename, pdf::access_pattern::normal, true);
+            pdf::make_pdf_parser(file.data().begin(), file.data().end());
+        });
+        cout << "mapped and populated: " << populated << " ms" << endl;
+        uint64_t bytes_read = 0;
+        auto pread = time_ms([&] {
+            auto source = make_unique<pdf::file_source>(filename);
+            auto s = source.get();
+            auto parser = pdf::make_pdf_parser(move(source));
+            bytes_read = s->bytes_read();
+        });
+        cout << "pread: " << pread << " ms, " << bytes_read << " bytes read" << endl;
+
+        if (args.empty())
+            remove(filename.c_str());
+    }
+
+    /*
+        A file of count objects, each a stream of length bytes.
+    */
+    void write_objects(const string& filename, unsigned count, unsigned length) {
+        ofstream file(filename, ios::binary);
+        file << "%PDF-1.4\n";
+        vector<long long> offsets;
+        string data(length, 'x');
+        for (unsigned id = 1; id <= count; ++id) {
+            offsets.push_back(file.tellp());
+            file << id << " 0 obj\n<< /Length " << length << " >>\nstream\n" << data << "\nendstream\nendobj\n";
+        }
+        auto xref = static_cast<long long>(file.tellp());
+        file << "xref\n0 " << count + 1 << "\n0000000000 65535 f\r\n";
+        char line[21];
+        for (auto offset : offsets) {
+            snprintf(line, sizeof line, "%010lld 00000 n\r\n", offset);
+            file << line;
+        }
+        file << "trailer\n<< /Size " << count + 1 << " >>\nstartxref\n" << xref << "\n%%EOF\n";
+    }
+
+    // drop the file from the page cache, so it is read from storage again
+    void evict(const string& filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+    }
+
+    /*
+        Loading every object from a cold page cache through a file_source, in an
+        order unrelated to their position in the file, with and without prefetching,
+        and all at once with get_all. Uses the given file, or makes a 256 MB one.
+    */
+    void prefetch(const vector<string>& args) {
+        string filename = args.empty() ? string(P_tmpdir) + "/pdfp_bench_objects.pdf" : args[0];
+        if (args.empty())
+            write_objects(filename, 32768, 8192);
+
+        auto run = [&](const char* name, bool prefetch, bool use_io_uring, bool batched = false) {
+            evict(filename);
+            auto ms = time_ms([&] {
+                pdf::file_source source(filename, 1 << 16, 1 << 13, use_io_uring);
+                auto tail = source.read(source.size() - min<uint64_t>(source.size(), 1024), 1024);
+                pdf::tools::atom_table atoms;
+                pdf::parser p(tail.data.find_last("startxref"), atoms);
+                p.expect_keyword(pdf::keywords::startxref);
+                pdf::xref_table xref(source);
+                xref.get_from(p.expect_integer());
+                pdf::object_loader objects(source, xref);
+                vector<pdf::tools::objref> refs;
+                for (unsigned id = 1; id < xref.size(); ++id)
+                    refs.push_back(pdf::tools::objref((id * 7919) % (xref.size() - 1) + 1, 0));
+                if (prefetch)
+                    objects.prefetch(refs);
+                if (batched)
+                    objects.get_all(refs);
+                else
+                    for (auto ref : refs)
+                        objects.get(ref);
+            });
+            cout << name << ": " << ms << " ms" << endl;
+        };
+        run("no prefetch", false, false);
+        run("prefetch with threads", true, false);
+        run("prefetch with io_uring", true, true);
+        run("get_all", false, false, true);
+
+        if (args.empty())
+            remove(filename.c_str());
+    }
+
+    /*
+        The ranges a remote file would be fetched in: the metadata, and every object
+        one at a time, for a range of gap thresholds. Uses the given file, or makes a
+        32 MB one.
+    */
+    void plan(const vector<string>& args) {
+        string filename = args.empty() ? string(P_tmpdir) + "/pdfp_bench_plan.pdf" : args[0];
+        if (args.empty())
+            write_objects(filename, 4096, 8192);
+
+        pdf::mapped_source source(filename);
+        pdf::xref_table xref(source);
+        xref.load();
+        vector<pdf::tools::objref> refs;
+        for (unsigned id = 1; id < xref.size(); id += 2)
+            refs.push_back(pdf::tools::objref(id, 0));
+        for (uint64_t gap : { 0, 1 << 12, 1 << 16, 1 << 20 }) {
+            pdf::range_planner planner(xref, source.size(), gap);
+            auto metadata = planner.metadata();
+            auto objects = planner.objects(refs);
+            cout << "gap " << gap << ": metadata " << metadata.size() << " ranges, "
+                 << pdf::total_length(metadata) << " bytes; every other object "
+                 << objects.size() << " ranges, " << pdf::total_length(objects) << " bytes" << endl;
+        }
+
+        if (args.empty())
+            remove(filename.c_str());
+    }
+
+    /*
+        A content stream of about size bytes, of text showing operators.
+    */
+    auto content_stream(size_t size) -> string {
+        string content;
+        for (unsigned i = 0; content.size() < size; ++i)
+            content += "BT /F" + to_string(i % 7) + " 12 Tf " + to_string(i % 500) + " " + to_string(i % 700) +
+                " Td (Line " + to_string(i) + " of some text) Tj ET\n";
+        return content;
+    }
+
+    /*
+        FlateDecode throughput, in MB of decoded data per second, on a large content
+        stream, decoded in one go, into a buffer sized from /DL, into an arena, and in
+        64 KB parts.
+    */
+    void flate(const vector<string>& args) {
+        size_t size = args.empty() ? 64 << 20 : stoul(args[0]) << 20;
+        auto content = content_stream(size);
+        string compressed(compressBound(content.size()), '\0');
+        uLongf length = compressed.size();
+        compress(reinterpret_cast<Bytef*>(&compressed[0]), &length, reinterpret_cast<const Bytef*>(content.data()),
+                 content.size());
+        compressed.resize(length);
+        cout << content.size() << " bytes, compressed to " << compressed.size() << endl;
+
+        pdf::tools::atom_table atoms;
+        auto with_length = *pdf::parser(("<</Filter /FlateDecode /DL " + to_string(content.size()) + ">>").c_str(),
+                                        atoms).next_object();
+        auto data = to_slice(compressed);
+        auto report = [&](const char* name, double ms) {
+            cout << name << ": " << ms << " ms, " << content.size() / 1048576.0 / (ms / 1000) << " MB/s" << endl;
+        };
+
+        report("flate_decode", time_ms([&] { pdf::flate_decode(data); }));
+        vector<char> buffer(pdf::decoded_length(with_length, data));
+        report("into a buffer", time_ms([&] { pdf::decode_stream(with_length, data, buffer.data(), buffer.size()); }));
+        report("into an arena", time_ms([&] {
+            pdf::tools::arena arena;
+            pdf::decode_stream(with_length, data, arena);
+        }));
+        report("in 64 KB parts", time_ms([&] {
+            pdf::flate_filter filter;
+            vector<char> part(1 << 16);
+            for (auto input = data;;) {
+                auto r = filter.decode(input, part.data(), part.size(), true);
+                input = input.skip(r.consumed);
+                if (r.done)
+                    break;
+            }
+        }));
+    }
+
+    // base-85 encodes data, in lines of 16 groups
+    auto a85_encode(const string& data) -> string {
+        string out;
+        for (size_t i = 0; i < data.size(); i += 4) {
+            uint32_t value = 0;
+            for (size_t j = 0; j < 4; ++j)
+                value = value << 8 | (i + j < data.size() ? static_cast<unsigned char>(data[i + j]) : 0);
+            char group[5];
+            for (int j = 4; j >= 0; --j, value /= 85)
+                group[j] = static_cast<char>('!' + value % 85);
+            out.append(group, min<size_t>(5, data.size() - i + 1));
+            if (i % 64 == 60)
+                out += '\n';
+        }
+        return out + "~>";
+    }
+
+    /*
+        ASCIIHexDecode and ASCII85Decode throughput, in MB of decoded data per second,
+        on random data encoded in lines of 64 characters, against per-character loops.
+    */
+    void ascii(const vector<string>& args) {
+        size_t size = args.empty() ? 64 << 20 : stoul(args[0]) << 20;
+        string data(size, '\0');
+        for (size_t i = 0; i < size; ++i)
+            data[i] = static_cast<char>(i * 2654435761u >> 13);
+        string hex;
+        for (size_t i = 0; i < size; ++i) {
+            hex += "0123456789abcdef"[static_cast<unsigned char>(data[i]) >> 4];
+            hex += "0123456789abcdef"[data[i] & 0xf];
+            if (i % 32 == 31)
+                hex += '\n';
+        }
+        hex += '>';
+        auto a85 = a85_encode(data);
+        auto report = [&](const char* name, double ms) {
+            cout << name << ": " << ms << " ms, " << size / 1048576.0 / (ms / 1000) << " MB/s" << endl;
+        };
+
+        report("ascii_hex_decode", time_ms([&] { pdf::ascii_hex_decode(to_slice(hex)); }));
+        report("hex, per character", time_ms([&] {
+            vector<char> out;
+            out.reserve(size);
+            int nibble = -1;
+            for (char ch : hex) {
+                int value = ch >= '0' && ch <= '9' ? ch - '0' : ch >= 'a' && ch <= 'f' ? ch - 'a' + 10 : -1;
+                if (value < 0)
+                    continue;
+                if (nibble < 0) {
+                    nibble = value;
+                } else {
+                    out.push_back(static_cast<char>(nibble << 4 | value));
+                    nibble = -1;
+                }
+            }
+        }));
+        report("ascii85_decode", time_ms([&] { pdf::ascii85_decode(to_slice(a85)); }));
+        report("base-85, per character", time_ms([&] {
+            vector<char> out;
+            out.reserve(size);
+            uint32_t value = 0;
+            int count = 0;
+            for (char ch : a85) {
+                if (ch < '!' || ch > 'u')
+                    continue;
+                value = value * 85 + (ch - '!');
+                if (++count == 5) {
+                    for (int shift = 24; shift >= 0; shift -= 8)
+                        out.push_back(static_cast<char>(value >> shift));
+                    value = 0;
+                    count = 0;
+                }
+            }
+        }));
+    }
+
+    // LZW encodes data with early change, clearing the table when it is full
+    auto lzw_encode(const string& data) -> string {
+        string out;
+        uint64_t bits = 0;
+        int count = 0, width = 9;
+        auto put = [&](unsigned code) {
+            bits = (bits << width) | code;
+            for (count += width; count >= 8; count -= 8)
+                out += static_cast<char>(bits >> (count - 8));
+        };
+        unordered_map<unsigned, unsigned> table;
+        unsigned next = 258, decoder_next = 258;
+        bool first = true;
+        put(256);
+        int w = -1;
+        for (char ch : data) {
+            unsigned c = static_cast<unsigned char>(ch);
+            auto found = w < 0 ? table.end() : table.find(w << 8 | c);
+            if (w < 0 || found != table.end()) {
+                w = w < 0 ? c : found->second;
+                continue;
+            }
+            put(w);
+            if (!first && ++decoder_next + 1 >= (1u << width) && width < 12)
+                ++width;
+            first = false;
+            table[w << 8 | c] = next++;
+            if (next == 4095) {
+                put(256);
+                table.clear();
+                next = decoder_next = 258;
+                width = 9;
+                first = true;
+            }
+            w = c;
+        }
+        if (w >= 0)
+            put(w);
+        put(257);
+        if (count > 0)
+            out += static_cast<char>(bits << (8 - count));
+        return out;
+    }
+
+    // the textbook LZW decoder, with a table of strings, as a baseline
+    auto lzw_reference(slice data) -> vector<char> {
+        vector<char> out;
+        vector<string> table;
+        string previous;
+        int width = 9;
+        uint32_t bits = 0;
+        int count = 0;
+        for (auto ch : data) {
+            bits = (bits << 8) | static_cast<unsigned char>(ch);
+            count += 8;
+            if (count < width)
+                continue;
+            unsigned code = (bits >> (count - width)) & ((1u << width) - 1);
+            count -= width;
+            if (code == 256) {
+                table.clear();
+                for (int i = 0; i < 256; ++i)
+                    table.push_back(string(1, static_cast<char>(i)));
+                table.resize(258);
+                previous.clear();
+                width = 9;
+                continue;
+            }
+            if (code == 257 || code > table.size())
+                break;
+            string current = code < table.size() ? table[code] : previous + previous[0];
+            if (!previous.empty())
+                table.push_back(previous + current[0]);
+            if (table.size() + 1 >= (1u << width) && width < 12)
+                ++width;
+            out.insert(out.end(), current.begin(), current.end());
+            previous = current;
+        }
+        return out;
+    }
+
+    /*
+        LZWDecode throughput, in MB of decoded data per second, on a large content
+        stream, against the textbook decoder.
+    */
+    void lzw(const vector<string>& args) {
+        size_t size = args.empty() ? 64 << 20 : stoul(args[0]) << 20;
+        auto content = content_stream(size);
+        auto encoded = lzw_encode(content);
+        cout << content.size() << " bytes, compressed to " << encoded.size() << endl;
+        auto decoded = pdf::lzw_decode(to_slice(encoded));
+        if (string(decoded.begin(), decoded.end()) != content || lzw_reference(to_slice(encoded)) != decoded)
+            throw runtime_error("lzw: decoded data differs");
+        auto report = [&](const char* name, double ms) {
+            cout << name << ": " << ms << " ms, " << content.size() / 1048576.0 / (ms / 1000) << " MB/s" << endl;
+        };
+        report("lzw_decode", time_ms([&] { pdf::lzw_decode(to_slice(encoded)); }));
+        report("reference", time_ms([&] { lzw_reference(to_slice(encoded)); }));
+    }
+
+    /*
+        A /Filter [/ASCII85Decode /FlateDecode] content stream, decoded a stage at a time
+        into whole intermediate buffers, and by a filter_pipeline in 64 KB reads.
+    */
+    void pipeline(const vector<string>& args) {
+        size_t size = args.empty() ? 64 << 20 : stoul(args[0]) << 20;
+        auto content = content_stream(size);
+        string compressed(compressBound(content.size()), '\0');
+        uLongf length = compressed.size();
+        compress(reinterpret_cast<Bytef*>(&compressed[0]), &length, reinterpret_cast<const Bytef*>(content.data()),
+                 content.size());
+        compressed.resize(length);
+        auto encoded = a85_encode(compressed);
+        cout << content.size() << " bytes, encoded to " << encoded.size() << endl;
+
+        pdf::tools::atom_table atoms;
+        auto dict = *pdf::parser("<</Filter [/ASCII85Decode /FlateDecode]>>", atoms).next_object();
+        auto report = [&](const char* name, double ms, size_t memory) {
+            cout << name << ": " << ms << " ms, " << content.size() / 1048576.0 / (ms / 1000) << " MB/s, "
+                 << memory / 1024 << " KB of intermediate data" << endl;
+        };
+
+        size_t intermediate = 0;
+        auto ms = time_ms([&] {
+            auto stage = pdf::ascii85_decode(to_slice(encoded));
+            intermediate = stage.size();
+            pdf::flate_decode(slice(stage.data(), stage.data() + stage.size()));
+        });
+        report("a stage at a time", ms, intermediate);
+        ms = time_ms([&] {
+            pdf::filter_pipeline pipeline(dict, to_slice(encoded));
+            vector<char> part(1 << 16);
+            while (!pipeline.done())
+                pipeline.read(part.data(), part.size());
+        });
+        report("filter_pipeline", ms, 1 << 16);
+    }
+
+    /*
+        decode_streams throughput and speedup over one thread, for 1, 2, 4, ... threads up
+        to the number of cores, on count flate compressed content streams of 8 to 120 KB.
+    */
+    void parallel(const vector<string>& args) {
+        size_t count = args.empty() ? 2000 : stoul(args[0]);
+        vector<string> compressed;
+        size_t total = 0;
+        for (size_t i = 0; i < count; ++i) {
+            auto content = content_stream((8 + i % 8 * 16) << 10);
+            total += content.size();
+            string out(compressBound(content.size()), '\0');
+            uLongf length = out.size();
+            compress(reinterpret_cast<Bytef*>(&out[0]), &length, reinterpret_cast<const Bytef*>(content.data()),
+                     content.size());
+            out.resize(length);
+            compressed.push_back(out);
+        }
+        pdf::tools::atom_table atoms;
+        auto dict = *pdf::parser("<</Filter /FlateDecode>>", atoms).next_object();
+        vector<pdf::indirect_object> objects;
+        for (size_t i = 0; i < count; ++i)
+            objects.emplace_back(pdf::objref(i + 1), dict, to_slice(compressed[i]));
+        auto cores = max(thread::hardware_concurrency(), 1u);
+        cout << count << " streams, " << total << " bytes, " << cores << " cores" << endl;
+
+        vector<unsigned> threads;
+        for (unsigned n = 1; n < cores; n *= 2)
+            threads.push_back(n);
+        threads.push_back(cores);
+        double single = 0;
+        for (auto n : threads) {
+            pdf::tools::task_scheduler scheduler(n);
+            auto ms = time_ms([&] { pdf::decode_streams(objects, scheduler); });
+            if (n == 1)
+                single = ms;
+            cout << n << " threads: " << ms << " ms, " << total / 1048576.0 / (ms / 1000) << " MB/s, speedup "
+                 << single / ms << ", efficiency " << single / ms / n << endl;
+        }
+    }
+
+    /*
+        PNG predictor throughput, in MB of decoded data per second, for each filter
+        type with 1, 3 and 4 bytes per pixel, on 64 MB of rows of 1024 pixels.
+    */
+    void png(const vector<string>& args) {
+        size_t size = args.empty() ? 64 << 20 : stoul(args[0]) << 20;
+        const int columns = 1024;
+        for (int colors : { 1, 3, 4 }) {
+            size_t row = columns * colors;
+            size_t rows = size / row;
+            string data((row + 1) * rows, '\0');
+            for (size_t i = 0; i < data.size(); ++i)
+                data[i] = static_cast<char>(i * 2654435761u >> 13);
+            const char* types[] = { "None", "Sub", "Up", "Average", "Paeth" };
+            for (int type = 0; type < 5; ++type) {
+                for (size_t r = 0; r < rows; ++r)
+                    data[r * (row + 1)] = static_cast<char>(type);
+                auto ms = time_ms([&] { pdf::png_predictor(to_slice(data), colors, 8, columns); });
+                cout << colors << " bytes per pixel, " << types[type] << ": " << ms << " ms, "
+                     << rows * row / 1048576.0 / (ms / 1000) << " MB/s" << endl;
+            }
+        }
+    }
+
+    const map<string, function<void(const vector<string>&)>> suites = {
+        { "ascii", ascii },
+        { "flate", flate },
+        { "lzw", lzw },
+        { "open", open },
+        { "parallel", parallel },
+        { "pipeline", pipeline },
+        { "plan", plan },
+        { "png", png },
+        { "prefetch", prefetch },
+        { "xref-cache", xref_cache },
+        { "xref-memory", xref_memory },
+    };
+
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || suites.find(argv[1]) == suites.end()) {
+        cout << "Usage: bench <suite> [<args>]\n\nsuites:\n";
+        for (auto& suite : suites)
+            cout << "  " << suite.first << "\n";
+        return 0;
+    }
+
+    try {
+        suites.at(argv[1])(std::vector<std::string>(argv + 2, argv + argc));
+    } catch (std::exception& ex) {
+        cout << "error> " << ex.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
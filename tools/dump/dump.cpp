@@ -1,32 +1,35 @@
 #include <iostream>
-#include <fstream>
+#include <memory>
 #include <stdexcept>
-#include <vector>
+#include <string>
 
+#include "byte_source.hpp"
 #include "pdfp.hpp"
-
-auto read_file(const char* filename) -> std::vector<char>
-{
-    std::ifstream file(filename, std::ios::binary);
-    if (!file.is_open())
-        throw std::runtime_error("failed to open file");
-    return std::vector<char>((std::istreambuf_iterator<char>(file)),
-                              std::istreambuf_iterator<char>());
-}
+#include "pipe_source.hpp"
 
 int main(int argc, char **argv) {
     using namespace std;
 
-    if (argc != 2) {
-        cout << "Usage: dump <filename>\n";
+    if (argc != 2 && argc != 3) {
+        cout << "Usage: dump <filename> [<xref cache>]\n"
+                "       dump - (reads the pdf from stdin)\n";
         return 0;
     }
 
-    auto pdf = read_file(argv[1]);
-    cout << argv[1] << ": " << pdf.size() << " bytes read" << endl;
-
     try {
-        auto pp = pdf::make_pdf_parser(pdf.data(), pdf.data() + pdf.size());
+        if (argv[1] == std::string("-")) {
+            auto source = std::make_unique<pdf::pipe_source>(0);
+            cout << "stdin: " << source->size() << " bytes read" << (source->spilled() ? " (spilled)" : "") << endl;
+            auto pp = pdf::make_pdf_parser(std::move(source));
+            return 0;
+        }
+
+        auto source = std::make_unique<pdf::mapped_source>(argv[1]);
+        cout << argv[1] << ": " << source->size() << " bytes mapped" << endl;
+
+        auto pp = argc == 3
+            ? pdf::make_pdf_parser(std::move(source), argv[1], argv[2])
+            : pdf::make_pdf_parser(std::move(source));
     } catch (pdf::pdf_error& ex) {
         cout << "pdf::pdf_error> " << ex.what() << endl;
     } catch (pdf::format_error& ex) {